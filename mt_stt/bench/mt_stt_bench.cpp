@@ -0,0 +1,186 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Measures the per-call latency of transcribing the same audio again and
+// again, once with loading the model on each call (as
+// mt_stt_transcribe_with_file() does) and once with a model loaded only once
+// via mt_stt_model_load_from_file().
+//
+// Optionally, the shared model is also stressed by the given count of threads
+// transcribing at the same time, verifying that each result equals the result
+// of the single-threaded run.
+//
+// Usage: mt_stt_bench <model file> [iterations] [n_threads] [audio seconds]
+//                     [concurrent threads]
+
+#include "../mt_stt.h"
+#include "mt_stt_bench_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(
+            stderr,
+            "Usage: %s <model file> [iterations] [n_threads] [audio seconds]"
+            " [concurrent threads]\n",
+            argv[0]);
+        return 1;
+    }
+
+    char* const model_file_path = argv[1];
+    int const iterations = 2 < argc ? atoi(argv[2]) : 5;
+    int const n_threads = 3 < argc ? atoi(argv[3]) : 4;
+    int const seconds = 4 < argc ? atoi(argv[4]) : 3;
+    int const concurrency = 5 < argc ? atoi(argv[5]) : 1;
+    std::vector<float> const audio = create_audio(seconds);
+    double without_handle_ms = 0.0;
+    double with_handle_ms = 0.0;
+    double load_ms = 0.0;
+    double concurrent_ms = 0.0;
+    std::string expected_text;
+    std::atomic<int> failures(0);
+
+    // Without handle (model is loaded and freed on each call):
+
+    for(int i = 0; i < iterations; ++i)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        char* const text = mt_stt_transcribe_with_file(
+            false,
+            n_threads,
+            "en",
+            false,
+            nullptr,
+            model_file_path,
+            audio.data(),
+            (int)audio.size(),
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            0);
+
+        without_handle_ms += get_ms_since(start);
+        if(text == nullptr)
+        {
+            fprintf(stderr, "Error: Transcription failed!\n");
+            return 1;
+        }
+        mt_stt_free(text);
+    }
+
+    // With handle (model is loaded once):
+
+    auto const load_start = std::chrono::steady_clock::now();
+    struct mt_stt_model * const model = mt_stt_model_load_from_file(
+        false, model_file_path);
+
+    load_ms = get_ms_since(load_start);
+    if(model == nullptr)
+    {
+        fprintf(stderr, "Error: Failed to load model!\n");
+        return 1;
+    }
+    for(int i = 0; i < iterations; ++i)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        char* const text = mt_stt_transcribe_with_model(
+            model,
+            n_threads,
+            "en",
+            false,
+            nullptr,
+            audio.data(),
+            (int)audio.size(),
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            0);
+
+        with_handle_ms += get_ms_since(start);
+        if(text == nullptr)
+        {
+            fprintf(stderr, "Error: Transcription failed!\n");
+            mt_stt_model_free(model);
+            return 1;
+        }
+        expected_text = text;
+        mt_stt_free(text);
+    }
+
+    // Many threads sharing the same model at the same time:
+
+    if(1 < concurrency)
+    {
+        std::vector<std::thread> threads;
+        auto const start = std::chrono::steady_clock::now();
+
+        for(int t = 0; t < concurrency; ++t)
+        {
+            threads.emplace_back(
+                [&]()
+                {
+                    for(int i = 0; i < iterations; ++i)
+                    {
+                        char* const text = mt_stt_transcribe_with_model(
+                            model,
+                            n_threads,
+                            "en",
+                            false,
+                            nullptr,
+                            audio.data(),
+                            (int)audio.size(),
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            0);
+
+                        if(text == nullptr || expected_text != text)
+                        {
+                            ++failures;
+                        }
+                        mt_stt_free(text);
+                    }
+                });
+        }
+        for(std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        concurrent_ms = get_ms_since(start);
+    }
+    mt_stt_model_free(model);
+
+    printf("audio_seconds = %d\n", seconds);
+    printf("iterations = %d\n", iterations);
+    printf("n_threads = %d\n", n_threads);
+    printf("without_handle_ms_per_call = %.1f\n", without_handle_ms / iterations);
+    printf("with_handle_load_ms = %.1f\n", load_ms);
+    printf("with_handle_ms_per_call = %.1f\n", with_handle_ms / iterations);
+    if(1 < concurrency)
+    {
+        printf("concurrent_threads = %d\n", concurrency);
+        printf(
+            "concurrent_calls_per_second = %.2f\n",
+            1000.0 * concurrency * iterations / concurrent_ms);
+        printf("concurrent_failures = %d\n", failures.load());
+    }
+    return failures.load() == 0 ? 0 : 1;
+}
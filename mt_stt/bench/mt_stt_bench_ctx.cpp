@@ -0,0 +1,230 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Measures the latency of transcribing parts of different lengths with the
+// full encoder context (30 seconds) and with a reduced encoder context (see
+// mt_stt_params.reduce_audio_ctx) and the word error rate of the results of
+// the reduced context relative to the results of the full context ("WER vs.
+// full context", not relative to a reference transcript).
+//
+// The parts are consecutive slices of the given WAV file, the results are
+// printed as Markdown table.
+//
+// Usage: mt_stt_bench_ctx <model file> <WAV file> [n_threads] [iterations]
+//                         [max. parts per length]
+
+#include "../mt_stt.h"
+#include "mt_stt_bench_util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/** Split the given text into lower-case words without punctuation.
+ */
+static std::vector<std::string> get_words(char const * const text)
+{
+    std::vector<std::string> ret_val;
+    std::string word;
+
+    for(char const * c = text; ; ++c)
+    {
+        if(*c == '\0' || isspace((unsigned char)*c))
+        {
+            if(!word.empty())
+            {
+                ret_val.push_back(word);
+                word.clear();
+            }
+            if(*c == '\0')
+            {
+                break;
+            }
+            continue;
+        }
+        if(ispunct((unsigned char)*c) && *c != '\'')
+        {
+            continue;
+        }
+        word += (char)tolower((unsigned char)*c);
+    }
+    return ret_val;
+}
+
+/** Get the word-level edit distance between the given texts.
+ */
+static int get_word_edits(
+    std::vector<std::string> const & ref, std::vector<std::string> const & hyp)
+{
+    std::vector<int> prev(hyp.size() + 1);
+    std::vector<int> cur(hyp.size() + 1);
+
+    for(size_t j = 0; j <= hyp.size(); ++j)
+    {
+        prev[j] = (int)j;
+    }
+    for(size_t i = 1; i <= ref.size(); ++i)
+    {
+        cur[0] = (int)i;
+        for(size_t j = 1; j <= hyp.size(); ++j)
+        {
+            cur[j] = std::min(
+                std::min(prev[j] + 1, cur[j - 1] + 1),
+                prev[j - 1] + (ref[i - 1] == hyp[j - 1] ? 0 : 1));
+        }
+        prev.swap(cur);
+    }
+    return prev[hyp.size()];
+}
+
+/** Transcribe the given frames iterations times and return the mean latency.
+ *
+ * - The text of the last iteration is returned via out_text.
+ * - Returns a negative value on error.
+ */
+static double transcribe(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & params_ref,
+    struct wav const & wav_ref,
+    int const frame_index,
+    int const frame_count,
+    int const iterations,
+    std::string & out_text)
+{
+    size_t const frame_size = wav_ref.data.size() / wav_ref.frame_count;
+    double ms = 0.0;
+
+    for(int i = 0; i < iterations; ++i)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        char* const text = mt_stt_transcribe_pcm(
+            model,
+            &params_ref,
+            wav_ref.data.data() + frame_index * frame_size,
+            wav_ref.format,
+            wav_ref.channels,
+            wav_ref.sample_rate,
+            frame_count,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            0);
+
+        ms += get_ms_since(start);
+        if(text == nullptr)
+        {
+            return -1.0;
+        }
+        out_text = text;
+        mt_stt_free(text);
+    }
+    return ms / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    static int const part_seconds[] = { 1, 2, 3, 5, 8, 10, 15, 20, 30 };
+
+    if(argc < 3)
+    {
+        fprintf(
+            stderr,
+            "Usage: %s <model file> <WAV file> [n_threads] [iterations]"
+            " [max. parts per length]\n",
+            argv[0]);
+        return 1;
+    }
+
+    struct wav wav;
+
+    if(!read_wav(argv[2], wav))
+    {
+        fprintf(stderr, "Error: Failed to read WAV file!\n");
+        return 1;
+    }
+
+    int const n_threads = 3 < argc ? atoi(argv[3]) : 4;
+    int const iterations = 4 < argc ? std::max(1, atoi(argv[4])) : 3;
+    int const max_parts = 5 < argc ? std::max(1, atoi(argv[5])) : 10;
+    struct mt_stt_model * const model = mt_stt_model_load_from_file(
+        false, argv[1]);
+
+    if(model == nullptr)
+    {
+        fprintf(stderr, "Error: Failed to load model!\n");
+        return 1;
+    }
+
+    struct mt_stt_params full_params;
+
+    mt_stt_params_init(&full_params);
+    full_params.n_threads = n_threads;
+    full_params.language = "en";
+
+    struct mt_stt_params reduced_params = full_params;
+
+    reduced_params.reduce_audio_ctx = true;
+
+    printf(
+        "| part s | parts | full ms | reduced ms | speed-up"
+        " | WER vs. full context |\n");
+    printf("|---:|---:|---:|---:|---:|---:|\n");
+
+    for(int const seconds : part_seconds)
+    {
+        int const frames = seconds * wav.sample_rate;
+        int const parts = std::min(max_parts, wav.frame_count / frames);
+        double full_ms = 0.0;
+        double reduced_ms = 0.0;
+        int edits = 0;
+        int ref_words = 0;
+
+        if(parts == 0)
+        {
+            break; // WAV file is too short.
+        }
+
+        for(int p = 0; p < parts; ++p)
+        {
+            std::string full_text;
+            std::string reduced_text;
+            double const f = transcribe(
+                model, full_params, wav, p * frames, frames, iterations,
+                full_text);
+            double const r = transcribe(
+                model, reduced_params, wav, p * frames, frames, iterations,
+                reduced_text);
+
+            if(f < 0.0 || r < 0.0)
+            {
+                fprintf(stderr, "Error: Transcription failed!\n");
+                mt_stt_model_free(model);
+                return 1;
+            }
+            full_ms += f;
+            reduced_ms += r;
+
+            std::vector<std::string> const ref = get_words(full_text.c_str());
+
+            edits += get_word_edits(ref, get_words(reduced_text.c_str()));
+            ref_words += (int)ref.size();
+        }
+
+        printf(
+            "| %d | %d | %.1f | %.1f | %.2fx | %.1f %% |\n",
+            seconds,
+            parts,
+            full_ms / parts,
+            reduced_ms / parts,
+            full_ms / reduced_ms,
+            ref_words == 0 ? 0.0 : 100.0 * edits / ref_words);
+        fflush(stdout);
+    }
+    mt_stt_model_free(model);
+    return 0;
+}
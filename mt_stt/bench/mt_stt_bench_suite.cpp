@@ -0,0 +1,578 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Benchmark suite to catch performance regressions (e.g. after updating the
+// Whisper.cpp submodule): Transcribes synthetic or WAV file audio with each
+// combination of the given APIs, thread counts, part counts, word
+// probabilities on/off, initial prompt lengths and decoding presets and
+// reports the real-time factor, latency percentiles, peak resident memory and
+// C++ allocation counts per combination as CSV or JSON.
+//
+// Usage: mt_stt_bench_suite --model <file> [options]
+//
+// Options (lists are comma-separated):
+//
+// --wav <file>            16 kHz WAV file (any channel count, 16 or 32 bit
+//                         integer or float samples), instead of synthetic
+//                         audio.
+// --seconds <n>           Length of the synthetic audio (default: 10).
+// --iterations <n>        Measured calls per combination, after one warm-up
+//                         call (default: 5).
+// --apis <list>           file, data, model and/or pcm (default: model).
+//                         pcm is the same as model, but with 16 bit integer
+//                         samples to be converted.
+// --threads <list>        n_threads values (default: 4).
+// --parts <list>          Count of equal parts to split the audio into, 1 for
+//                         no parts (default: 1).
+// --workers <n>           Parts transcribed at the same time (default: 1).
+// --word-probs <list>     0 and/or 1 (default: 0).
+// --prompt-words <list>   Length of the initial prompt in words (default: 0).
+// --presets <list>        default, fastest, balanced and/or accurate (model
+//                         and pcm APIs, only, default: default).
+// --format <csv|json>     Output format (default: csv).
+
+#include "../mt_stt.h"
+#include "mt_stt_bench_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif //_WIN32
+
+// Count of C++ allocations of the whole process (including the libraries),
+// via replacing the global operator new (allocations via malloc() are not
+// counted):
+//
+static std::atomic<long long> s_alloc_count(0);
+static std::atomic<long long> s_alloc_bytes(0);
+
+void* operator new(size_t size)
+{
+    ++s_alloc_count;
+    s_alloc_bytes += (long long)size;
+
+    void* const ret_val = malloc(size == 0 ? 1 : size);
+
+    if(ret_val == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ret_val;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+/** The results of one combination.
+ */
+struct result
+{
+    std::string api;
+    int n_threads;
+    int parts;
+    int word_probs;
+    int prompt_words;
+    std::string preset;
+    double audio_s;
+    int iterations;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double rtf;
+    long long peak_rss_kb;
+    double allocs_per_call;
+    double alloc_kb_per_call;
+};
+
+/** Reset the peak resident memory of the process to the current one, to
+ *  measure it per combination.
+ *
+ * - Linux only (elsewhere, the peak is the one of the whole process so far).
+ */
+static void reset_peak_rss()
+{
+#ifdef __linux__
+    FILE * const file = fopen("/proc/self/clear_refs", "w");
+
+    if(file != nullptr)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif //__linux__
+}
+
+static long long get_peak_rss_kb()
+{
+#ifdef _WIN32
+    return 0; // Not implemented.
+#else //_WIN32
+    #ifdef __linux__
+        // Reset by reset_peak_rss() (unlike the maximum of getrusage()):
+        //
+        FILE * const file = fopen("/proc/self/status", "r");
+
+        if(file != nullptr)
+        {
+            char line[256];
+            long long kb = -1;
+
+            while(kb < 0 && fgets(line, sizeof line, file) != nullptr)
+            {
+                if(sscanf(line, "VmHWM: %lld kB", &kb) != 1)
+                {
+                    kb = -1;
+                }
+            }
+            fclose(file);
+            if(0 <= kb)
+            {
+                return kb;
+            }
+        }
+    #endif //__linux__
+
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    #ifdef __APPLE__
+        return (long long)usage.ru_maxrss / 1024;
+    #else //__APPLE__
+        return (long long)usage.ru_maxrss;
+    #endif //__APPLE__
+#endif //_WIN32
+}
+
+static std::vector<std::string> split(std::string const & str_ref)
+{
+    std::vector<std::string> ret_val;
+    size_t start = 0;
+
+    while(start <= str_ref.size())
+    {
+        size_t end = str_ref.find(',', start);
+
+        if(end == std::string::npos)
+        {
+            end = str_ref.size();
+        }
+        if(start < end)
+        {
+            ret_val.push_back(str_ref.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return ret_val;
+}
+
+static std::vector<int> split_ints(std::string const & str_ref)
+{
+    std::vector<int> ret_val;
+
+    for(std::string const & s : split(str_ref))
+    {
+        ret_val.push_back(atoi(s.c_str()));
+    }
+    return ret_val;
+}
+
+/** Get the latency at the given percentile (nearest rank) of the given sorted
+ *  latencies.
+ */
+static double get_percentile(std::vector<double> const & sorted, int const p)
+{
+    size_t rank = (sorted.size() * p + 99) / 100;
+
+    if(rank == 0)
+    {
+        rank = 1;
+    }
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static bool read_file(char const * const path, std::vector<char> & out_data)
+{
+    FILE * const file = fopen(path, "rb");
+
+    if(file == nullptr)
+    {
+        return false;
+    }
+
+    char block[65536];
+    size_t n = 0;
+
+    out_data.clear();
+    while((n = fread(block, 1, sizeof block, file)) != 0)
+    {
+        out_data.insert(out_data.end(), block, block + n);
+    }
+    fclose(file);
+    return !out_data.empty();
+}
+
+static void print_csv(std::vector<struct result> const & results)
+{
+    printf(
+        "api,n_threads,parts,word_probs,prompt_words,preset,audio_s,iterations,"
+        "mean_ms,p50_ms,p95_ms,p99_ms,rtf,peak_rss_kb,allocs_per_call,"
+        "alloc_kb_per_call\n");
+    for(struct result const & r : results)
+    {
+        printf(
+            "%s,%d,%d,%d,%d,%s,%.2f,%d,%.2f,%.2f,%.2f,%.2f,%.4f,%lld,%.1f,"
+                "%.1f\n",
+            r.api.c_str(),
+            r.n_threads,
+            r.parts,
+            r.word_probs,
+            r.prompt_words,
+            r.preset.c_str(),
+            r.audio_s,
+            r.iterations,
+            r.mean_ms,
+            r.p50_ms,
+            r.p95_ms,
+            r.p99_ms,
+            r.rtf,
+            r.peak_rss_kb,
+            r.allocs_per_call,
+            r.alloc_kb_per_call);
+    }
+}
+
+static void print_json(std::vector<struct result> const & results)
+{
+    printf("[\n");
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        struct result const & r = results[i];
+
+        printf(
+            "  {\"api\": \"%s\", \"n_threads\": %d, \"parts\": %d,"
+            " \"word_probs\": %d, \"prompt_words\": %d, \"preset\": \"%s\","
+            " \"audio_s\": %.2f,"
+            " \"iterations\": %d, \"mean_ms\": %.2f, \"p50_ms\": %.2f,"
+            " \"p95_ms\": %.2f, \"p99_ms\": %.2f, \"rtf\": %.4f,"
+            " \"peak_rss_kb\": %lld, \"allocs_per_call\": %.1f,"
+            " \"alloc_kb_per_call\": %.1f}%s\n",
+            r.api.c_str(),
+            r.n_threads,
+            r.parts,
+            r.word_probs,
+            r.prompt_words,
+            r.preset.c_str(),
+            r.audio_s,
+            r.iterations,
+            r.mean_ms,
+            r.p50_ms,
+            r.p95_ms,
+            r.p99_ms,
+            r.rtf,
+            r.peak_rss_kb,
+            r.allocs_per_call,
+            r.alloc_kb_per_call,
+            i + 1 < results.size() ? "," : "");
+    }
+    printf("]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    char const * model_file_path = nullptr;
+    char const * wav_file_path = nullptr;
+    int seconds = 10;
+    int iterations = 5;
+    int workers = 1;
+    std::vector<std::string> apis = { "model" };
+    std::vector<int> threads_list = { 4 };
+    std::vector<int> parts_list = { 1 };
+    std::vector<int> word_probs_list = { 0 };
+    std::vector<int> prompt_words_list = { 0 };
+    std::vector<std::string> presets = { "default" };
+    bool json = false;
+
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string const name = argv[i];
+        char const * const value = argv[i + 1];
+
+        if(name == "--model") model_file_path = value;
+        else if(name == "--wav") wav_file_path = value;
+        else if(name == "--seconds") seconds = atoi(value);
+        else if(name == "--iterations") iterations = atoi(value);
+        else if(name == "--apis") apis = split(value);
+        else if(name == "--threads") threads_list = split_ints(value);
+        else if(name == "--parts") parts_list = split_ints(value);
+        else if(name == "--workers") workers = atoi(value);
+        else if(name == "--word-probs") word_probs_list = split_ints(value);
+        else if(name == "--prompt-words") prompt_words_list = split_ints(value);
+        else if(name == "--presets") presets = split(value);
+        else if(name == "--format") json = strcmp(value, "json") == 0;
+        else
+        {
+            fprintf(stderr, "Error: Unknown option \"%s\"!\n", name.c_str());
+            return 1;
+        }
+    }
+    if(model_file_path == nullptr || iterations < 1 || seconds < 1)
+    {
+        fprintf(
+            stderr,
+            "Usage: %s --model <file> [--wav <file>] [--seconds <n>]"
+            " [--iterations <n>] [--apis file,data,model,pcm] [--threads <list>]"
+            " [--parts <list>] [--workers <n>] [--word-probs 0,1]"
+            " [--prompt-words <list>] [--presets <list>] [--format csv|json]\n",
+            argv[0]);
+        return 1;
+    }
+
+    std::vector<float> audio;
+    std::vector<int16_t> audio_s16; // For the pcm API.
+
+    if(wav_file_path != nullptr)
+    {
+        struct wav wav;
+
+        if(!read_wav(wav_file_path, wav) || wav.sample_rate != s_sample_rate)
+        {
+            fprintf(stderr, "Error: Failed to read 16 kHz WAV file!\n");
+            return 1;
+        }
+        audio = get_mono_samples(wav);
+    }
+    else
+    {
+        audio = create_audio(seconds);
+    }
+
+    std::vector<char> model_data;
+    struct mt_stt_model * model = nullptr;
+
+    for(std::string const & api : apis)
+    {
+        if(api == "data" && model_data.empty()
+            && !read_file(model_file_path, model_data))
+        {
+            fprintf(stderr, "Error: Failed to read model file!\n");
+            return 1;
+        }
+        if((api == "model" || api == "pcm") && model == nullptr)
+        {
+            model = mt_stt_model_load_from_file(false, model_file_path);
+            if(model == nullptr)
+            {
+                fprintf(stderr, "Error: Failed to load model!\n");
+                return 1;
+            }
+        }
+    }
+
+    for(float const sample : audio)
+    {
+        audio_s16.push_back(
+            (int16_t)(std::max(-1.0f, std::min(1.0f, sample)) * 32767.0f));
+    }
+
+    std::vector<struct result> results;
+    int const audio_len = (int)audio.size();
+
+    for(std::string const & api : apis)
+    for(int const n_threads : threads_list)
+    for(int const parts : parts_list)
+    for(int const word_probs : word_probs_list)
+    for(int const prompt_words : prompt_words_list)
+    for(std::string const & preset : presets)
+    {
+        int const parts_count = std::max(1, parts);
+        std::vector<int> indices(parts_count);
+        std::vector<int> limits(parts_count);
+        std::vector<int> ret_indices(parts_count);
+        std::string prompt;
+        std::vector<double> latencies;
+        long long allocs = 0;
+        long long alloc_bytes = 0;
+
+        for(int i = 0; i < parts_count; ++i)
+        {
+            indices[i] = (int)((long long)audio_len * i / parts_count);
+            limits[i] = (int)((long long)audio_len * (i + 1) / parts_count);
+        }
+        for(int i = 0; i < prompt_words; ++i)
+        {
+            prompt += i == 0 ? "word" : " word";
+        }
+
+        struct mt_stt_decoding_params decoding;
+
+        if(!mt_stt_decoding_params_init_by_name(&decoding, preset.c_str()))
+        {
+            fprintf(stderr, "Error: Unknown preset \"%s\"!\n", preset.c_str());
+            return 1;
+        }
+
+        struct mt_stt_params params;
+
+        mt_stt_params_init(&params);
+        params.opt_decoding_params = &decoding;
+        params.n_threads = n_threads;
+        params.language = "en";
+        params.initial_prompt = prompt.empty() ? nullptr : prompt.c_str();
+        params.parts_workers = workers;
+        params.parts_context = MT_STT_PARTS_CONTEXT_PER_WORKER;
+
+        reset_peak_rss();
+        for(int i = 0; i <= iterations; ++i) // First call is for warm-up.
+        {
+            float * probs = nullptr;
+            int probs_count = 0;
+            float * * const opt_probs = word_probs != 0 ? &probs : nullptr;
+            int * const opt_probs_count =
+                word_probs != 0 ? &probs_count : nullptr;
+            int * const opt_ret = 1 < parts_count ? ret_indices.data() : nullptr;
+            int const * const opt_idx = 1 < parts_count ? indices.data() : nullptr;
+            int const * const opt_lim = 1 < parts_count ? limits.data() : nullptr;
+            int const opt_len = 1 < parts_count ? parts_count : 0;
+            long long const count_before = s_alloc_count.load();
+            long long const bytes_before = s_alloc_bytes.load();
+            auto const start = std::chrono::steady_clock::now();
+            char* text = nullptr;
+
+            if(api == "file")
+            {
+                text = mt_stt_transcribe_with_file(
+                    false, n_threads, "en", false, params.initial_prompt,
+                    (char*)model_file_path, audio.data(), audio_len, nullptr,
+                    opt_probs, opt_probs_count, opt_ret, opt_idx, opt_lim,
+                    opt_len);
+            }
+            else if(api == "data")
+            {
+                text = mt_stt_transcribe_with_data(
+                    false, n_threads, "en", false, params.initial_prompt,
+                    model_data.data(), model_data.size(), audio.data(),
+                    audio_len, nullptr, opt_probs, opt_probs_count, opt_ret,
+                    opt_idx, opt_lim, opt_len);
+            }
+            else if(api == "model")
+            {
+                text = mt_stt_transcribe_with_params(
+                    model, &params, audio.data(), audio_len, opt_probs,
+                    opt_probs_count, opt_ret, opt_idx, opt_lim, opt_len);
+            }
+            else if(api == "pcm")
+            {
+                text = mt_stt_transcribe_pcm(
+                    model, &params, audio_s16.data(),
+                    MT_STT_SAMPLE_FORMAT_S16, 1, s_sample_rate, audio_len,
+                    opt_probs, opt_probs_count, opt_ret, opt_idx, opt_lim,
+                    opt_len);
+            }
+            else
+            {
+                fprintf(stderr, "Error: Unknown API \"%s\"!\n", api.c_str());
+                mt_stt_model_free(model);
+                return 1;
+            }
+
+            double const ms = get_ms_since(start);
+
+            if(text == nullptr)
+            {
+                fprintf(stderr, "Error: Transcription failed!\n");
+                mt_stt_model_free(model);
+                return 1;
+            }
+            mt_stt_free(text);
+            mt_stt_free(probs);
+
+            if(i == 0)
+            {
+                continue; // Warm-up.
+            }
+            latencies.push_back(ms);
+            allocs += s_alloc_count.load() - count_before;
+            alloc_bytes += s_alloc_bytes.load() - bytes_before;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        struct result r;
+        double sum = 0.0;
+
+        for(double const ms : latencies)
+        {
+            sum += ms;
+        }
+        r.api = api;
+        r.n_threads = n_threads;
+        r.parts = parts_count;
+        r.word_probs = word_probs;
+        r.prompt_words = prompt_words;
+        r.preset = preset;
+        r.audio_s = (double)audio_len / s_sample_rate;
+        r.iterations = iterations;
+        r.mean_ms = sum / iterations;
+        r.p50_ms = get_percentile(latencies, 50);
+        r.p95_ms = get_percentile(latencies, 95);
+        r.p99_ms = get_percentile(latencies, 99);
+        r.rtf = r.mean_ms / (1000.0 * r.audio_s);
+        r.peak_rss_kb = get_peak_rss_kb();
+        r.allocs_per_call = (double)allocs / iterations;
+        r.alloc_kb_per_call = (double)alloc_bytes / 1024.0 / iterations;
+        results.push_back(r);
+
+        fprintf(
+            stderr,
+            "%s n_threads=%d parts=%d word_probs=%d prompt_words=%d:"
+            " p50 %.1f ms\n",
+            api.c_str(), n_threads, parts_count, word_probs, prompt_words,
+            r.p50_ms);
+    }
+    mt_stt_model_free(model);
+
+    if(json)
+    {
+        print_json(results);
+    }
+    else
+    {
+        print_csv(results);
+    }
+    return 0;
+}
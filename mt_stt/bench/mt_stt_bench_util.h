@@ -0,0 +1,192 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Helpers shared by the benchmark programs.
+
+#ifndef MT_STT_BENCH_UTIL
+#define MT_STT_BENCH_UTIL
+
+#include "../mt_stt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static int const s_sample_rate = 16000;
+
+/** Create synthetic audio: A quiet, amplitude-modulated tone with some noise.
+ */
+static inline std::vector<float> create_audio(int const seconds)
+{
+    std::vector<float> ret_val(s_sample_rate * seconds);
+
+    srand(1);
+    for(size_t i = 0; i < ret_val.size(); ++i)
+    {
+        float const t = (float)i / (float)s_sample_rate;
+        float const noise = ((float)rand() / (float)RAND_MAX - 0.5f) * 0.02f;
+
+        ret_val[i] = 0.1f
+            * sinf(2.0f * 3.14159265f * 220.0f * t)
+            * (0.5f + 0.5f * sinf(2.0f * 3.14159265f * 3.0f * t))
+            + noise;
+    }
+    return ret_val;
+}
+
+static inline double get_ms_since(
+    std::chrono::steady_clock::time_point const start)
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+/** The PCM audio data of a WAV file.
+ */
+struct wav
+{
+    std::vector<unsigned char> data; // Interleaved samples.
+    enum mt_stt_sample_format format;
+    int channels;
+    int sample_rate;
+    int frame_count;
+};
+
+static inline uint32_t get_u32(unsigned char const * const p)
+{
+    return (uint32_t)p[0]
+        | (uint32_t)p[1] << 8
+        | (uint32_t)p[2] << 16
+        | (uint32_t)p[3] << 24;
+}
+
+static inline uint16_t get_u16(unsigned char const * const p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+/** Read a WAV file with 16 or 32 bit integer or 32 bit float samples.
+ *
+ * - Returns false on error.
+ */
+static inline bool read_wav(char const * const path, struct wav & out_wav)
+{
+    FILE * const file = fopen(path, "rb");
+
+    if(file == nullptr)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> buf;
+    unsigned char block[4096];
+    size_t n = 0;
+
+    while((n = fread(block, 1, sizeof block, file)) != 0)
+    {
+        buf.insert(buf.end(), block, block + n);
+    }
+    fclose(file);
+
+    if(buf.size() < 12
+        || memcmp(buf.data(), "RIFF", 4) != 0
+        || memcmp(buf.data() + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+
+    int tag = 0;
+    int bits = 0;
+    size_t pos = 12;
+
+    out_wav.channels = 0;
+    while(pos + 8 <= buf.size())
+    {
+        unsigned char const * const chunk = buf.data() + pos;
+        size_t const len = get_u32(chunk + 4);
+        size_t const avail = std::min(len, buf.size() - pos - 8);
+
+        if(memcmp(chunk, "fmt ", 4) == 0 && 16 <= avail)
+        {
+            tag = get_u16(chunk + 8);
+            out_wav.channels = get_u16(chunk + 10);
+            out_wav.sample_rate = (int)get_u32(chunk + 12);
+            bits = get_u16(chunk + 22);
+            if(tag == 0xFFFE && 26 <= avail) // WAVE_FORMAT_EXTENSIBLE
+            {
+                tag = get_u16(chunk + 32); // First bytes of sub-format GUID.
+            }
+        }
+        else if(memcmp(chunk, "data", 4) == 0 && out_wav.channels != 0)
+        {
+            out_wav.data.assign(chunk + 8, chunk + 8 + avail);
+        }
+        pos += 8 + len + (len & 1);
+    }
+
+    if(tag == 1 && bits == 16)
+    {
+        out_wav.format = MT_STT_SAMPLE_FORMAT_S16;
+    }
+    else if(tag == 1 && bits == 32)
+    {
+        out_wav.format = MT_STT_SAMPLE_FORMAT_S32;
+    }
+    else if(tag == 3 && bits == 32)
+    {
+        out_wav.format = MT_STT_SAMPLE_FORMAT_F32;
+    }
+    else
+    {
+        return false; // Unsupported (or missing) format.
+    }
+    if(out_wav.channels <= 0 || out_wav.sample_rate <= 0)
+    {
+        return false;
+    }
+    out_wav.frame_count =
+        (int)(out_wav.data.size() / (out_wav.channels * bits / 8));
+    return 0 < out_wav.frame_count;
+}
+
+
+/** Get the samples of the given WAV data as mono, normalized float samples
+ *  (the sample rate is kept).
+ */
+static inline std::vector<float> get_mono_samples(struct wav const & wav_ref)
+{
+    std::vector<float> ret_val(wav_ref.frame_count, 0.0f);
+    size_t const frame_size = wav_ref.data.size() / wav_ref.frame_count;
+    size_t const sample_size = frame_size / wav_ref.channels;
+
+    for(int i = 0; i < wav_ref.frame_count; ++i)
+    {
+        for(int c = 0; c < wav_ref.channels; ++c)
+        {
+            unsigned char const * const p =
+                wav_ref.data.data() + i * frame_size + c * sample_size;
+            float sample = 0.0f;
+
+            switch(wav_ref.format)
+            {
+                case MT_STT_SAMPLE_FORMAT_S16:
+                    sample = (float)(int16_t)get_u16(p) / 32768.0f;
+                    break;
+                case MT_STT_SAMPLE_FORMAT_S32:
+                    sample = (float)((double)(int32_t)get_u32(p) / 2147483648.0);
+                    break;
+                default:
+                    memcpy(&sample, p, sizeof sample);
+                    break;
+            }
+            ret_val[i] += sample / (float)wav_ref.channels;
+        }
+    }
+    return ret_val;
+}
+
+#endif //MT_STT_BENCH_UTIL
@@ -0,0 +1,915 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Client library of mt_stt_daemon (libmtstt_client.so), implementing the
+// transcription functions of mt_stt.h by sending the requests to the daemon
+// (see mt_stt_client.h).
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "../mt_stt.h"
+#include "mt_stt_client.h"
+#include "mt_stt_daemon_protocol.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** A model loaded by the daemon.
+ */
+struct mt_stt_model
+{
+    int id;
+};
+
+/** A memfd mapped into the memory of this process.
+ */
+struct shared_buf
+{
+    int fd;
+    char * data;
+    size_t size;
+};
+
+// Buffers allocated via mt_stt_client_buffer_alloc(), by address:
+//
+static std::mutex s_bufs_mutex;
+static std::map<char const *, struct shared_buf> s_bufs;
+
+// Texts returned as static strings by the daemon (e.g. language codes), to be
+// returned as static strings here, too:
+//
+static std::mutex s_texts_mutex;
+static std::set<std::string> s_texts;
+
+static char const * get_static_text(std::string const & text_ref)
+{
+    std::lock_guard<std::mutex> const lock(s_texts_mutex);
+
+    return s_texts.insert(text_ref).first->c_str();
+}
+
+/** Create a memfd of the given size, sealed against shrinking, and map it.
+ *
+ * - Returns false on error.
+ */
+static bool create_buf(size_t const size, struct shared_buf & out_buf)
+{
+    out_buf.fd = memfd_create("mt_stt_audio", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(out_buf.fd < 0)
+    {
+        return false;
+    }
+    if(ftruncate(out_buf.fd, (off_t)size) != 0
+        || fcntl(out_buf.fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0)
+    {
+        close(out_buf.fd);
+        out_buf.fd = -1;
+        return false;
+    }
+
+    void * const map = mmap(
+        nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, out_buf.fd, 0);
+
+    if(map == MAP_FAILED)
+    {
+        close(out_buf.fd);
+        out_buf.fd = -1;
+        return false;
+    }
+    out_buf.data = (char *)map;
+    out_buf.size = size;
+    return true;
+}
+
+static void free_buf(struct shared_buf & buf_ref)
+{
+    if(buf_ref.data != nullptr)
+    {
+        munmap(buf_ref.data, buf_ref.size);
+    }
+    if(0 <= buf_ref.fd)
+    {
+        close(buf_ref.fd);
+    }
+    buf_ref.fd = -1;
+    buf_ref.data = nullptr;
+    buf_ref.size = 0;
+}
+
+/** The buffer of a thread, freed when the thread ends.
+ */
+struct thread_buf
+{
+    struct shared_buf buf = { -1, nullptr, 0 };
+
+    ~thread_buf()
+    {
+        free_buf(buf);
+    }
+};
+
+// Used to copy audio data to (by all transcriptions of the same thread, to
+// avoid creating a memfd for each transcription, it is never shrinked):
+//
+static thread_local struct thread_buf s_audio_buf;
+
+/** Get the memfd and offset of the given data, which is either inside of a
+ *  buffer allocated via mt_stt_client_buffer_alloc() or gets copied to the
+ *  buffer of the calling thread.
+ *
+ * - Returns -1 on error.
+ */
+static int get_fd(
+    void const * const data, size_t const len, uint64_t & out_offset)
+{
+    char const * const ptr = (char const *)data;
+
+    out_offset = 0;
+
+    {
+        std::lock_guard<std::mutex> const lock(s_bufs_mutex);
+        auto it = s_bufs.upper_bound(ptr);
+
+        if(it != s_bufs.begin())
+        {
+            --it;
+
+            struct shared_buf const & buf_ref = it->second;
+
+            if(buf_ref.data <= ptr && len <= buf_ref.size
+                && (size_t)(ptr - buf_ref.data) <= buf_ref.size - len)
+            {
+                out_offset = (uint64_t)(ptr - buf_ref.data);
+                return buf_ref.fd; // No copy needed.
+            }
+        }
+    }
+
+    struct shared_buf & audio_buf_ref = s_audio_buf.buf;
+
+    if(audio_buf_ref.size < len)
+    {
+        free_buf(audio_buf_ref);
+        if(!create_buf(len, audio_buf_ref))
+        {
+            return -1;
+        }
+    }
+    memcpy(audio_buf_ref.data, data, len);
+    return audio_buf_ref.fd;
+}
+
+/** Send the given request to the daemon (via a new connection) and receive
+ *  the response.
+ *
+ * - Returns false on error (also, if the daemon returned an error status).
+ */
+static bool request(
+    enum mt_stt_daemon_op const op,
+    std::vector<char> const & payload_ref,
+    int const opt_fd,
+    std::vector<char> & out_payload)
+{
+    char const * path = getenv("MT_STT_DAEMON_SOCKET");
+    struct sockaddr_un addr;
+
+    if(path == nullptr)
+    {
+        path = MT_STT_DAEMON_DEFAULT_SOCKET;
+    }
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if(sizeof addr.sun_path <= strlen(path))
+    {
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    int const sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(sock < 0)
+    {
+        return false;
+    }
+    if(connect(sock, (struct sockaddr *)&addr, sizeof addr) != 0)
+    {
+        close(sock);
+        return false;
+    }
+
+    struct mt_stt_daemon_request_header const header = {
+        MT_STT_DAEMON_MAGIC,
+        MT_STT_DAEMON_VERSION,
+        (uint32_t)op,
+        (uint32_t)payload_ref.size() };
+    struct mt_stt_daemon_response_header response;
+    int fd = -1;
+    bool ret_val = mt_stt_daemon_send(
+            sock, &header, sizeof header, payload_ref, opt_fd)
+        && mt_stt_daemon_recv_header(sock, &response, sizeof response, fd)
+        && response.magic == MT_STT_DAEMON_MAGIC
+        && response.payload_size <= MT_STT_DAEMON_MAX_PAYLOAD;
+
+    if(0 <= fd)
+    {
+        close(fd); // Not expected.
+    }
+    if(ret_val)
+    {
+        out_payload.resize(response.payload_size);
+        ret_val = mt_stt_daemon_recv_all(
+                sock, out_payload.data(), out_payload.size())
+            && response.status == 0;
+    }
+    close(sock);
+    return ret_val;
+}
+
+/** Send the given model load request and create the handle of the model.
+ *
+ * - Returns NULL on error.
+ */
+static struct mt_stt_model * load_model(
+    enum mt_stt_daemon_op const op,
+    std::vector<char> const & payload_ref,
+    int const opt_fd)
+{
+    std::vector<char> response;
+    struct mt_stt_daemon_reader reader;
+    int32_t id;
+
+    if(!request(op, payload_ref, opt_fd, response))
+    {
+        return nullptr;
+    }
+    reader = { response.data(), response.data() + response.size() };
+    if(!mt_stt_daemon_get(reader, id) || id < 0)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_model * const ret_val = new mt_stt_model;
+
+    ret_val->id = id;
+    return ret_val;
+}
+
+/** Read the response of a transcription and fill the given outputs.
+ *
+ * - Returns the text or NULL on error.
+ */
+static char* read_transcribe_response(
+    std::vector<char> const & response_ref,
+    struct mt_stt_params const * const params,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices)
+{
+    struct mt_stt_daemon_reader reader = {
+        response_ref.data(), response_ref.data() + response_ref.size() };
+    std::string text;
+    bool text_null;
+    std::vector<float> probs;
+    bool probs_null;
+    std::vector<int32_t> ret_indices;
+    bool ret_indices_null;
+    uint8_t aborted;
+    std::string language;
+    bool language_null;
+    float language_p;
+    uint8_t has_metrics;
+
+    if(!mt_stt_daemon_get_str(reader, text, text_null)
+        || !mt_stt_daemon_get_arr(reader, probs, probs_null)
+        || !mt_stt_daemon_get_arr(reader, ret_indices, ret_indices_null)
+        || !mt_stt_daemon_get(reader, aborted)
+        || !mt_stt_daemon_get_str(reader, language, language_null)
+        || !mt_stt_daemon_get(reader, language_p)
+        || !mt_stt_daemon_get(reader, has_metrics))
+    {
+        return nullptr;
+    }
+
+    if(params->opt_out_aborted != nullptr)
+    {
+        *params->opt_out_aborted = aborted != 0;
+    }
+    if(text_null)
+    {
+        return nullptr;
+    }
+
+    if(params->opt_out_language != nullptr)
+    {
+        params->opt_out_language->code =
+            language_null ? nullptr : get_static_text(language);
+        params->opt_out_language->p = language_p;
+    }
+
+    if(has_metrics != 0 && params->opt_out_metrics != nullptr)
+    {
+        struct mt_stt_metrics metrics;
+        std::string cpu_variant;
+        bool cpu_variant_null;
+        std::vector<struct mt_stt_part_metrics> parts;
+        bool parts_null;
+
+        if(!mt_stt_daemon_get(reader, metrics)
+            || !mt_stt_daemon_get_str(reader, cpu_variant, cpu_variant_null)
+            || !mt_stt_daemon_get_arr(reader, parts, parts_null))
+        {
+            return nullptr;
+        }
+        metrics.cpu_variant =
+            cpu_variant_null ? nullptr : get_static_text(cpu_variant);
+        metrics.parts_count = 0;
+        metrics.parts = nullptr;
+        if(!parts_null)
+        {
+            size_t const bytes = parts.size() * sizeof *metrics.parts;
+
+            metrics.parts = (struct mt_stt_part_metrics *)malloc(bytes);
+            if(metrics.parts == nullptr)
+            {
+                return nullptr;
+            }
+            memcpy(metrics.parts, parts.data(), bytes);
+            metrics.parts_count = (int)parts.size();
+        }
+        *params->opt_out_metrics = metrics;
+    }
+
+    if(opt_out_word_probs != nullptr)
+    {
+        *opt_out_word_probs = nullptr;
+        *opt_out_word_probs_count = 0;
+        if(!probs.empty())
+        {
+            size_t const bytes = probs.size() * sizeof(float);
+
+            *opt_out_word_probs = (float *)malloc(bytes);
+            if(*opt_out_word_probs == nullptr)
+            {
+                return nullptr;
+            }
+            memcpy(*opt_out_word_probs, probs.data(), bytes);
+            *opt_out_word_probs_count = (int)probs.size();
+        }
+    }
+
+    if(opt_out_parts_ret_val_indices != nullptr)
+    {
+        memcpy(
+            opt_out_parts_ret_val_indices,
+            ret_indices.data(),
+            ret_indices.size() * sizeof(int32_t));
+    }
+
+    char * const ret_val = (char *)malloc(text.size() + 1);
+
+    if(ret_val == nullptr)
+    {
+        return nullptr;
+    }
+    memcpy(ret_val, text.c_str(), text.size() + 1);
+    return ret_val;
+}
+
+/** Transcribe the given audio data via the daemon.
+ *
+ * - sample_format is -1 for mono, 32-bit float, 16 kHz samples (frame_count
+ *   is the count of samples, then).
+ * - Returns NULL on error (also, if a segment callback is given, because the
+ *   segments are not sent by the daemon).
+ */
+static char* transcribe(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    void const * const audio_data,
+    int const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    size_t const bytes_per_frame,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    if(model == nullptr || params == nullptr || audio_data == nullptr
+        || params->on_segment_func != nullptr
+        || frame_count <= 0 || bytes_per_frame == 0
+        || (opt_out_word_probs == nullptr)
+            != (opt_out_word_probs_count == nullptr)
+        || (opt_parts_audio_data_indices == nullptr)
+            != (opt_parts_audio_data_limits == nullptr)
+        || (opt_parts_audio_data_indices != nullptr
+            && (opt_parts_length <= 0
+                || opt_out_parts_ret_val_indices == nullptr)))
+    {
+        return nullptr;
+    }
+
+    uint64_t offset;
+    int const fd = get_fd(
+        audio_data, (size_t)frame_count * bytes_per_frame, offset);
+
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_daemon_transcribe t;
+    std::vector<char> payload;
+    std::vector<char> response;
+
+    memset(&t, 0, sizeof t);
+    t.model_id = model->id;
+    t.audio_offset = offset;
+    t.sample_format = sample_format;
+    t.channels = channels;
+    t.sample_rate = sample_rate;
+    t.frame_count = frame_count;
+    t.n_threads = params->n_threads;
+    t.translate_to_en = params->translate_to_en ? 1 : 0;
+    t.prompt_id = params->prompt_id;
+    t.parts_workers = params->parts_workers;
+    t.parts_context = (int32_t)params->parts_context;
+    t.vad_threshold_db = params->vad_threshold_db;
+    t.vad_min_energy_db = params->vad_min_energy_db;
+    t.vad_min_speech_ms = params->vad_min_speech_ms;
+    t.vad_min_silence_ms = params->vad_min_silence_ms;
+    t.vad_pad_ms = params->vad_pad_ms;
+    t.reduce_audio_ctx = params->reduce_audio_ctx ? 1 : 0;
+    t.min_audio_ctx = params->min_audio_ctx;
+    t.detect_language_once = params->detect_language_once ? 1 : 0;
+    t.detect_language_ms = params->detect_language_ms;
+    t.timeout_ms = params->timeout_ms;
+    t.return_partial_on_abort = params->return_partial_on_abort ? 1 : 0;
+    t.word_probs = opt_out_word_probs != nullptr ? 1 : 0;
+    t.metrics = params->opt_out_metrics != nullptr ? 1 : 0;
+
+    mt_stt_daemon_put(payload, t);
+    mt_stt_daemon_put_str(payload, params->language);
+    mt_stt_daemon_put_str(payload, params->initial_prompt);
+    mt_stt_daemon_put_str(payload, params->opt_language_cache_key);
+    mt_stt_daemon_put_arr(
+        payload, params->prompt_tokens, params->prompt_n_tokens);
+    if(params->opt_decoding_params == nullptr)
+    {
+        mt_stt_daemon_put_arr<char>(payload, nullptr, 0);
+    }
+    else // => Size is validated by the daemon.
+    {
+        mt_stt_daemon_put_arr(
+            payload,
+            (char const *)params->opt_decoding_params,
+            (int)std::min(
+                params->opt_decoding_params->size,
+                sizeof *params->opt_decoding_params));
+    }
+    mt_stt_daemon_put_arr(
+        payload, opt_parts_audio_data_indices, opt_parts_length);
+    mt_stt_daemon_put_arr(
+        payload, opt_parts_audio_data_limits, opt_parts_length);
+
+    if(!request(MT_STT_DAEMON_OP_TRANSCRIBE, payload, fd, response))
+    {
+        return nullptr;
+    }
+    return read_transcribe_response(
+        response,
+        params,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices);
+}
+
+/** Transcribe with the given model and the parameters of the original
+ *  functions (on_progress_func is not supported).
+ */
+static char* transcribe_simple(
+    struct mt_stt_model * const model,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    struct mt_stt_params params;
+
+    mt_stt_params_init(&params);
+    params.n_threads = n_threads;
+    params.language = language;
+    params.translate_to_en = translate_to_en;
+    params.initial_prompt = initial_prompt;
+
+    return mt_stt_transcribe_with_params(
+        model,
+        &params,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API void * __stdcall mt_stt_client_buffer_alloc(
+    size_t const size)
+{
+    struct shared_buf buf;
+
+    if(size == 0 || !create_buf(size, buf))
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> const lock(s_bufs_mutex);
+
+    s_bufs.emplace(buf.data, buf);
+    return buf.data;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_client_buffer_free(void * const buf)
+{
+    if(buf == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> const lock(s_bufs_mutex);
+    auto const it = s_bufs.find((char const *)buf);
+
+    if(it == s_bufs.end())
+    {
+        return;
+    }
+    free_buf(it->second);
+    s_bufs.erase(it);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_free(void * const ptr)
+{
+    free(ptr);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_params_init(
+    struct mt_stt_params * const params)
+{
+    if(params == nullptr)
+    {
+        return;
+    }
+
+    // * Must be the same as in mt_stt.cpp!
+
+    params->n_threads = 0;
+    params->language = nullptr;
+    params->translate_to_en = false;
+    params->initial_prompt = nullptr;
+    params->opt_decoding_params = nullptr;
+    params->prompt_tokens = nullptr;
+    params->prompt_n_tokens = 0;
+    params->prompt_id = -1;
+    params->on_progress_func = nullptr;
+
+    params->parts_workers = 1;
+    params->parts_context = MT_STT_PARTS_CONTEXT_FULL;
+
+    params->vad_threshold_db = 10.0f;
+    params->vad_min_energy_db = -50.0f;
+    params->vad_min_speech_ms = 250;
+    params->vad_min_silence_ms = 500;
+    params->vad_pad_ms = 200;
+
+    params->reduce_audio_ctx = false;
+    params->min_audio_ctx = 256;
+
+    params->opt_out_metrics = nullptr;
+
+    params->detect_language_once = false;
+    params->detect_language_ms = 10000;
+    params->opt_language_cache_key = nullptr;
+    params->opt_out_language = nullptr;
+
+    params->opt_cancel_token = nullptr;
+    params->timeout_ms = 0;
+    params->return_partial_on_abort = false;
+    params->opt_out_aborted = nullptr;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init_by_name(
+    struct mt_stt_decoding_params * const params, char const * const name)
+{
+    if(params == nullptr || name == nullptr)
+    {
+        return false;
+    }
+
+    std::vector<char> payload;
+    std::vector<char> response;
+    struct mt_stt_daemon_reader reader;
+
+    mt_stt_daemon_put_str(payload, name);
+    if(!request(
+        MT_STT_DAEMON_OP_DECODING_PARAMS_INIT, payload, -1, response))
+    {
+        return false;
+    }
+    reader = { response.data(), response.data() + response.size() };
+    return mt_stt_daemon_get(reader, *params);
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init(
+    struct mt_stt_decoding_params * const params,
+    enum mt_stt_preset const preset)
+{
+    switch(preset)
+    {
+        case MT_STT_PRESET_DEFAULT:
+            return mt_stt_decoding_params_init_by_name(params, "default");
+        case MT_STT_PRESET_FASTEST:
+            return mt_stt_decoding_params_init_by_name(params, "fastest");
+        case MT_STT_PRESET_BALANCED:
+            return mt_stt_decoding_params_init_by_name(params, "balanced");
+        case MT_STT_PRESET_ACCURATE:
+            return mt_stt_decoding_params_init_by_name(params, "accurate");
+        default:
+            return false;
+    }
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_file(
+    bool const use_gpu, char const * const model_file_path)
+{
+    if(model_file_path == nullptr)
+    {
+        return nullptr;
+    }
+
+    // The daemon may have another working directory:
+    //
+    char abs_path[PATH_MAX];
+
+    if(realpath(model_file_path, abs_path) == nullptr)
+    {
+        return nullptr;
+    }
+
+    std::vector<char> payload;
+
+    mt_stt_daemon_put<uint8_t>(payload, use_gpu ? 1 : 0);
+    mt_stt_daemon_put_str(payload, abs_path);
+    return load_model(MT_STT_DAEMON_OP_LOAD_MODEL_FILE, payload, -1);
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_data(
+    bool const use_gpu, void * const model_data, size_t const model_data_len)
+{
+    if(model_data == nullptr || model_data_len == 0)
+    {
+        return nullptr;
+    }
+
+    // Not copied to the buffer of the thread, which would stay that big:
+    //
+    struct shared_buf buf;
+
+    if(!create_buf(model_data_len, buf))
+    {
+        return nullptr;
+    }
+    memcpy(buf.data, model_data, model_data_len);
+
+    std::vector<char> payload;
+
+    mt_stt_daemon_put<uint8_t>(payload, use_gpu ? 1 : 0);
+    mt_stt_daemon_put<uint64_t>(payload, (uint64_t)model_data_len);
+
+    struct mt_stt_model * const ret_val = load_model(
+        MT_STT_DAEMON_OP_LOAD_MODEL_DATA, payload, buf.fd);
+
+    free_buf(buf);
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_model_free(
+    struct mt_stt_model * const model)
+{
+    delete model; // The daemon keeps the model loaded.
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_file(
+    bool const use_gpu,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    char * const model_file_path,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    (void)on_progress_func; // Not supported.
+
+    struct mt_stt_model * const model = mt_stt_model_load_from_file(
+        use_gpu, model_file_path);
+    char * const ret_val = transcribe_simple(
+        model,
+        n_threads,
+        language,
+        translate_to_en,
+        initial_prompt,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+
+    mt_stt_model_free(model);
+    return ret_val;
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_data(
+    bool const use_gpu,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    void * const model_data,
+    size_t const model_data_len,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    (void)on_progress_func; // Not supported.
+
+    struct mt_stt_model * const model = mt_stt_model_load_from_data(
+        use_gpu, model_data, model_data_len);
+    char * const ret_val = transcribe_simple(
+        model,
+        n_threads,
+        language,
+        translate_to_en,
+        initial_prompt,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+
+    mt_stt_model_free(model);
+    return ret_val;
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_model(
+    struct mt_stt_model * const model,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    (void)on_progress_func; // Not supported.
+
+    return transcribe_simple(
+        model,
+        n_threads,
+        language,
+        translate_to_en,
+        initial_prompt,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_params(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    return transcribe(
+        model,
+        params,
+        audio_data_arr,
+        -1,
+        1,
+        16000,
+        audio_data_length,
+        sizeof(float),
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_pcm(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_frame_indices,
+    int const * const opt_parts_frame_limits,
+    int const opt_parts_length)
+{
+    size_t const bytes_per_sample =
+        sample_format == MT_STT_SAMPLE_FORMAT_S16 ? sizeof(int16_t)
+        : sample_format == MT_STT_SAMPLE_FORMAT_S32 ? sizeof(int32_t)
+        : sample_format == MT_STT_SAMPLE_FORMAT_F32 ? sizeof(float)
+        : 0;
+
+    if(channels <= 0)
+    {
+        return nullptr;
+    }
+    return transcribe(
+        model,
+        params,
+        pcm_data,
+        (int)sample_format,
+        channels,
+        sample_rate,
+        frame_count,
+        bytes_per_sample * (size_t)channels,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_frame_indices,
+        opt_parts_frame_limits,
+        opt_parts_length);
+}
@@ -0,0 +1,62 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Additions of the client library of mt_stt_daemon (libmtstt_client.so) to
+// the interface of mt_stt (see mt_stt.h).
+//
+// The client library implements these functions of mt_stt.h by sending the
+// requests to mt_stt_daemon (so existing callers can switch by linking with
+// libmtstt_client.so instead of libmtstt.so):
+//
+// - mt_stt_free()
+// - mt_stt_params_init()
+// - mt_stt_decoding_params_init() and mt_stt_decoding_params_init_by_name()
+// - mt_stt_model_load_from_file(), mt_stt_model_load_from_data() and
+//   mt_stt_model_free()
+// - mt_stt_transcribe_with_file(), mt_stt_transcribe_with_data(),
+//   mt_stt_transcribe_with_model(), mt_stt_transcribe_with_params() and
+//   mt_stt_transcribe_pcm()
+//
+// - The path of the daemon's socket is taken from environment variable
+//   MT_STT_DAEMON_SOCKET (or MT_STT_DAEMON_DEFAULT_SOCKET is used).
+// - Models are loaded by the daemon and stay loaded there, mt_stt_model_free()
+//   just frees the handle.
+// - Progress callbacks and cancellation tokens are ignored (timeout_ms is
+//   supported). The functions return NULL, if the daemon is not reachable.
+// - Segment callbacks are not supported, the transcription functions return
+//   NULL, if mt_stt_params.on_segment_func is set.
+// - The audio data is copied into shared memory (a memfd reused by the
+//   calling thread) that the daemon reads from. Audio data held by a buffer
+//   allocated via mt_stt_client_buffer_alloc() is not copied at all.
+
+#ifndef MT_STT_CLIENT
+#define MT_STT_CLIENT
+
+#include "../mt_stt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * - Allocates a buffer of the given size in shared memory, audio data given
+ *   to the transcription functions from inside of it is read by the daemon
+ *   directly (without copying it).
+ * - The buffer must not be freed while a transcription of its data runs.
+ * - Caller takes ownership of the returned buffer, which needs to be freed via
+ *   mt_stt_client_buffer_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API void * __stdcall mt_stt_client_buffer_alloc(
+    size_t const size);
+
+/**
+ * - Frees a buffer allocated via mt_stt_client_buffer_alloc().
+ * - Does nothing, if NULL is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_client_buffer_free(void * const buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MT_STT_CLIENT
@@ -0,0 +1,670 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Local transcription daemon (Linux, only): Keeps models loaded and serves
+// transcription requests of local client processes via a Unix domain socket
+// (see mt_stt_daemon_protocol.h and the client library mt_stt_client.cpp).
+//
+// - Models are loaded once (on first request or at startup) and kept until
+//   the daemon exits, so all clients share them and their warm caches.
+// - The audio data is not copied through the socket, but given as memfd by
+//   the client (which is mapped read-only by the daemon).
+// - Each connection is served by its own thread, transcriptions of multiple
+//   clients may run at the same time.
+//
+// Usage: mt_stt_daemon [--socket <path>] [--gpu] [--model <file>]...
+//                      [--result-cache-mb <n>]
+//
+// --socket <path>         Path of the socket (default: Environment variable
+//                         MT_STT_DAEMON_SOCKET or
+//                         MT_STT_DAEMON_DEFAULT_SOCKET).
+// --gpu                   Load the models given via --model with GPU usage.
+// --model <file>          Load this model at startup (may be given multiple
+//                         times, other models are loaded on first request).
+// --result-cache-mb <n>   Enable the result cache of each model with this
+//                         size (see mt_stt_result_cache_configure()).
+
+#include "../mt_stt.h"
+#include "../mt_stt_hash.h"
+#include "mt_stt_daemon_protocol.h"
+
+#include <algorithm>
+#include <climits>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static char const * s_socket_path = nullptr;
+static size_t s_result_cache_bytes = 0;
+
+// Models loaded, their index is their ID (they are never freed):
+//
+static std::mutex s_load_mutex;
+static std::mutex s_models_mutex;
+static std::vector<struct mt_stt_model *> s_models;
+static std::unordered_map<std::string, int> s_model_ids; // By key.
+
+static void on_signal(int const signum)
+{
+    (void)signum;
+
+    unlink(s_socket_path);
+    _exit(0);
+}
+
+/** Map the given count of bytes of the given memfd (beginning at offset)
+ *  read-only.
+ *
+ * - The memfd must be sealed against shrinking (otherwise the client could
+ *   crash the daemon by truncating it during the transcription). Other files
+ *   (that can not be sealed) are rejected for the same reason.
+ * - Growing and writing do not need to be sealed: The mapping stays valid
+ *   and a client changing its audio data during the transcription just gets
+ *   a garbled result (writing must stay possible, because buffers allocated
+ *   via mt_stt_client_buffer_alloc() are reused by the client).
+ * - Sets out_map and out_map_len to what must be unmapped via munmap().
+ * - Returns NULL on error.
+ */
+static void const * map_fd(
+    int const fd,
+    uint64_t const offset,
+    uint64_t const len,
+    void * & out_map,
+    size_t & out_map_len)
+{
+    struct stat st;
+
+    out_map = nullptr;
+    out_map_len = 0;
+
+    if(fd < 0 || len == 0 || UINT64_MAX - offset < len
+        || SIZE_MAX < offset + len)
+    {
+        return nullptr;
+    }
+
+    int const seals = fcntl(fd, F_GET_SEALS); // -1, if not a memfd.
+
+    if(seals < 0 || (seals & F_SEAL_SHRINK) == 0)
+    {
+        fprintf(stderr, "Error: memfd is not sealed against shrinking!\n");
+        return nullptr;
+    }
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < offset + len)
+    {
+        return nullptr;
+    }
+
+    void * const map = mmap(
+        nullptr, (size_t)(offset + len), PROT_READ, MAP_SHARED, fd, 0);
+
+    if(map == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    out_map = map;
+    out_map_len = (size_t)(offset + len);
+    return (char const *)map + offset;
+}
+
+static struct mt_stt_model * get_model(int const id)
+{
+    std::lock_guard<std::mutex> const lock(s_models_mutex);
+
+    if(id < 0 || (int)s_models.size() <= id)
+    {
+        return nullptr;
+    }
+    return s_models[id];
+}
+
+/** Get the ID of the model with the given key or load the model via the
+ *  given function and add it.
+ *
+ * - Returns -1 on error.
+ */
+template<typename F> static int get_model_id(std::string const & key_ref, F load)
+{
+    // Models are loaded one after another, so the same model is never loaded
+    // twice (without blocking the transcriptions with loaded models):
+    //
+    std::lock_guard<std::mutex> const load_lock(s_load_mutex);
+
+    {
+        std::lock_guard<std::mutex> const lock(s_models_mutex);
+        auto const it = s_model_ids.find(key_ref);
+
+        if(it != s_model_ids.end())
+        {
+            return it->second;
+        }
+    }
+
+    struct mt_stt_model * const model = load();
+
+    if(model == nullptr)
+    {
+        return -1;
+    }
+    if(0 < s_result_cache_bytes)
+    {
+        mt_stt_result_cache_configure(model, s_result_cache_bytes);
+    }
+
+    std::lock_guard<std::mutex> const lock(s_models_mutex);
+    int const ret_val = (int)s_models.size();
+
+    s_models.push_back(model);
+    s_model_ids.emplace(key_ref, ret_val);
+    return ret_val;
+}
+
+static int load_model_file(bool const use_gpu, char const * const path)
+{
+    char abs_path[PATH_MAX];
+
+    if(realpath(path, abs_path) == nullptr)
+    {
+        fprintf(stderr, "Error: Model file \"%s\" not found!\n", path);
+        return -1;
+    }
+
+    int const ret_val = get_model_id(
+        std::string(use_gpu ? "gpu:" : "cpu:") + abs_path,
+        [&]()
+        {
+            fprintf(stderr, "Loading model \"%s\"..\n", abs_path);
+            return mt_stt_model_load_from_file(use_gpu, abs_path);
+        });
+
+    if(ret_val < 0)
+    {
+        fprintf(stderr, "Error: Failed to load model \"%s\"!\n", abs_path);
+    }
+    return ret_val;
+}
+
+static int load_model_data(bool const use_gpu, int const fd, uint64_t const len)
+{
+    void * map = nullptr;
+    size_t map_len = 0;
+    void const * const data = map_fd(fd, 0, len, map, map_len);
+
+    if(data == nullptr)
+    {
+        return -1;
+    }
+
+    char key[64];
+
+    // Models given by data are identified by a hash of the data, so repeated
+    // calls of mt_stt_transcribe_with_data() do not load the model, again:
+    //
+    snprintf(
+        key,
+        sizeof key,
+        "%s:%016llx:%llu",
+        use_gpu ? "gpu" : "cpu",
+        (unsigned long long)mt_stt_get_hash(data, (size_t)len),
+        (unsigned long long)len);
+
+    int const ret_val = get_model_id(
+        key,
+        [&]()
+        {
+            fprintf(stderr, "Loading model from data (%s)..\n", key);
+            return mt_stt_model_load_from_data(
+                use_gpu, (void *)data, (size_t)len);
+        });
+
+    munmap(map, map_len);
+    return ret_val;
+}
+
+static size_t get_bytes_per_frame(
+    int32_t const sample_format, int32_t const channels)
+{
+    if(channels <= 0)
+    {
+        return 0;
+    }
+    switch(sample_format)
+    {
+        case -1: return channels == 1 ? sizeof(float) : 0;
+        case MT_STT_SAMPLE_FORMAT_F32: return sizeof(float) * channels;
+        case MT_STT_SAMPLE_FORMAT_S16: return sizeof(int16_t) * channels;
+        case MT_STT_SAMPLE_FORMAT_S32: return sizeof(int32_t) * channels;
+        default: return 0;
+    }
+}
+
+/** Transcribe as requested by the given payload and create the response
+ *  payload.
+ *
+ * - Returns false on protocol errors, only (a failed transcription is
+ *   returned as NULL text).
+ */
+static bool transcribe(
+    int const fd,
+    std::vector<char> const & payload_ref,
+    std::vector<char> & out_payload)
+{
+    struct mt_stt_daemon_reader reader = {
+        payload_ref.data(), payload_ref.data() + payload_ref.size() };
+    struct mt_stt_daemon_transcribe t;
+    std::string language;
+    std::string initial_prompt;
+    std::string cache_key;
+    std::vector<int32_t> prompt_tokens;
+    std::vector<char> decoding_data;
+    std::vector<int32_t> indices;
+    std::vector<int32_t> limits;
+    bool language_null;
+    bool initial_prompt_null;
+    bool cache_key_null;
+    bool prompt_tokens_null;
+    bool decoding_null;
+    bool indices_null;
+    bool limits_null;
+
+    if(!mt_stt_daemon_get(reader, t)
+        || !mt_stt_daemon_get_str(reader, language, language_null)
+        || !mt_stt_daemon_get_str(reader, initial_prompt, initial_prompt_null)
+        || !mt_stt_daemon_get_str(reader, cache_key, cache_key_null)
+        || !mt_stt_daemon_get_arr(reader, prompt_tokens, prompt_tokens_null)
+        || !mt_stt_daemon_get_arr(reader, decoding_data, decoding_null)
+        || !mt_stt_daemon_get_arr(reader, indices, indices_null)
+        || !mt_stt_daemon_get_arr(reader, limits, limits_null)
+        || indices_null != limits_null
+        || indices.size() != limits.size())
+    {
+        return false;
+    }
+
+    // The decoding parameters are validated by the library (including their
+    // size), but must not be shorter than the structure:
+    //
+    struct mt_stt_decoding_params decoding;
+
+    memset(&decoding, 0, sizeof decoding);
+    memcpy(
+        &decoding,
+        decoding_data.data(),
+        std::min(decoding_data.size(), sizeof decoding));
+
+    struct mt_stt_params params;
+    struct mt_stt_metrics metrics;
+    struct mt_stt_language detected = { nullptr, 0.0f };
+    bool aborted = false;
+
+    mt_stt_params_init(&params);
+    params.n_threads = t.n_threads;
+    params.language = language_null ? nullptr : language.c_str();
+    params.translate_to_en = t.translate_to_en != 0;
+    params.initial_prompt =
+        initial_prompt_null ? nullptr : initial_prompt.c_str();
+    params.opt_decoding_params = decoding_null ? nullptr : &decoding;
+    params.prompt_tokens = prompt_tokens_null ? nullptr : prompt_tokens.data();
+    params.prompt_n_tokens = (int)prompt_tokens.size();
+    params.prompt_id = t.prompt_id;
+    params.parts_workers = t.parts_workers;
+    params.parts_context = (enum mt_stt_parts_context)t.parts_context;
+    params.vad_threshold_db = t.vad_threshold_db;
+    params.vad_min_energy_db = t.vad_min_energy_db;
+    params.vad_min_speech_ms = t.vad_min_speech_ms;
+    params.vad_min_silence_ms = t.vad_min_silence_ms;
+    params.vad_pad_ms = t.vad_pad_ms;
+    params.reduce_audio_ctx = t.reduce_audio_ctx != 0;
+    params.min_audio_ctx = t.min_audio_ctx;
+    params.opt_out_metrics = t.metrics != 0 ? &metrics : nullptr;
+    params.detect_language_once = t.detect_language_once != 0;
+    params.detect_language_ms = t.detect_language_ms;
+    params.opt_language_cache_key = cache_key_null ? nullptr : cache_key.c_str();
+    params.opt_out_language = &detected;
+    params.timeout_ms = t.timeout_ms;
+    params.return_partial_on_abort = t.return_partial_on_abort != 0;
+    params.opt_out_aborted = &aborted;
+
+    struct mt_stt_model * const model = get_model(t.model_id);
+    size_t const bytes_per_frame =
+        get_bytes_per_frame(t.sample_format, t.channels);
+    void * map = nullptr;
+    size_t map_len = 0;
+    void const * const audio = model == nullptr || bytes_per_frame == 0
+            || t.frame_count <= 0
+            || t.audio_offset % (bytes_per_frame / t.channels) != 0
+        ? nullptr
+        : map_fd(
+            fd,
+            t.audio_offset,
+            (uint64_t)t.frame_count * bytes_per_frame,
+            map,
+            map_len);
+    int const parts_length = (int)indices.size();
+    std::vector<int> ret_indices(parts_length);
+    float * probs = nullptr;
+    int probs_count = 0;
+    char * text = nullptr;
+
+    if(audio != nullptr && t.sample_format == -1)
+    {
+        text = mt_stt_transcribe_with_params(
+            model,
+            &params,
+            (float const *)audio,
+            t.frame_count,
+            t.word_probs != 0 ? &probs : nullptr,
+            t.word_probs != 0 ? &probs_count : nullptr,
+            indices_null ? nullptr : ret_indices.data(),
+            indices_null ? nullptr : indices.data(),
+            indices_null ? nullptr : limits.data(),
+            parts_length);
+    }
+    else if(audio != nullptr)
+    {
+        text = mt_stt_transcribe_pcm(
+            model,
+            &params,
+            audio,
+            (enum mt_stt_sample_format)t.sample_format,
+            t.channels,
+            t.sample_rate,
+            t.frame_count,
+            t.word_probs != 0 ? &probs : nullptr,
+            t.word_probs != 0 ? &probs_count : nullptr,
+            indices_null ? nullptr : ret_indices.data(),
+            indices_null ? nullptr : indices.data(),
+            indices_null ? nullptr : limits.data(),
+            parts_length);
+    }
+    if(map != nullptr)
+    {
+        munmap(map, map_len);
+    }
+
+    mt_stt_daemon_put_str(out_payload, text);
+    mt_stt_daemon_put_arr(out_payload, probs, probs_count);
+    mt_stt_daemon_put_arr(
+        out_payload,
+        text == nullptr || indices_null ? nullptr : ret_indices.data(),
+        parts_length);
+    mt_stt_daemon_put<uint8_t>(out_payload, aborted ? 1 : 0);
+    mt_stt_daemon_put_str(out_payload, detected.code);
+    mt_stt_daemon_put(out_payload, detected.p);
+    mt_stt_daemon_put<uint8_t>(
+        out_payload, text != nullptr && t.metrics != 0 ? 1 : 0);
+    if(text != nullptr && t.metrics != 0)
+    {
+        struct mt_stt_metrics fixed = metrics;
+
+        fixed.cpu_variant = nullptr;
+        fixed.parts_count = 0;
+        fixed.parts = nullptr;
+        mt_stt_daemon_put(out_payload, fixed);
+        mt_stt_daemon_put_str(out_payload, metrics.cpu_variant);
+        mt_stt_daemon_put_arr(out_payload, metrics.parts, metrics.parts_count);
+        mt_stt_free(metrics.parts);
+    }
+
+    mt_stt_free(text);
+    mt_stt_free(probs);
+    return true;
+}
+
+/** Handle the given request and create the response payload.
+ *
+ * - Returns the status of the response (0 on success).
+ */
+static int handle(
+    struct mt_stt_daemon_request_header const & header_ref,
+    int const fd,
+    std::vector<char> const & payload_ref,
+    std::vector<char> & out_payload)
+{
+    struct mt_stt_daemon_reader reader = {
+        payload_ref.data(), payload_ref.data() + payload_ref.size() };
+
+    out_payload.clear();
+    switch(header_ref.op)
+    {
+        case MT_STT_DAEMON_OP_LOAD_MODEL_FILE:
+        {
+            uint8_t use_gpu;
+            std::string path;
+            bool is_null;
+
+            if(!mt_stt_daemon_get(reader, use_gpu)
+                || !mt_stt_daemon_get_str(reader, path, is_null) || is_null)
+            {
+                return -1;
+            }
+
+            int const id = load_model_file(use_gpu != 0, path.c_str());
+
+            mt_stt_daemon_put<int32_t>(out_payload, id);
+            return id < 0 ? 1 : 0;
+        }
+
+        case MT_STT_DAEMON_OP_LOAD_MODEL_DATA:
+        {
+            uint8_t use_gpu;
+            uint64_t len;
+
+            if(!mt_stt_daemon_get(reader, use_gpu)
+                || !mt_stt_daemon_get(reader, len))
+            {
+                return -1;
+            }
+
+            int const id = load_model_data(use_gpu != 0, fd, len);
+
+            mt_stt_daemon_put<int32_t>(out_payload, id);
+            return id < 0 ? 1 : 0;
+        }
+
+        case MT_STT_DAEMON_OP_TRANSCRIBE:
+        {
+            return transcribe(fd, payload_ref, out_payload) ? 0 : -1;
+        }
+
+        case MT_STT_DAEMON_OP_DECODING_PARAMS_INIT:
+        {
+            std::string name;
+            bool is_null;
+            struct mt_stt_decoding_params decoding;
+
+            if(!mt_stt_daemon_get_str(reader, name, is_null) || is_null)
+            {
+                return -1;
+            }
+            if(!mt_stt_decoding_params_init_by_name(&decoding, name.c_str()))
+            {
+                return 1;
+            }
+            mt_stt_daemon_put(out_payload, decoding);
+            return 0;
+        }
+
+        default:
+        {
+            return -1;
+        }
+    }
+}
+
+/** Serve the requests of one connection, until it is closed by the client
+ *  (or on protocol errors).
+ */
+static void serve(int const sock)
+{
+    std::vector<char> payload;
+    std::vector<char> response_payload;
+
+    while(true)
+    {
+        struct mt_stt_daemon_request_header header;
+        int fd = -1;
+
+        if(!mt_stt_daemon_recv_header(sock, &header, sizeof header, fd))
+        {
+            break; // Closed by the client.
+        }
+        if(header.magic != MT_STT_DAEMON_MAGIC
+            || header.version != MT_STT_DAEMON_VERSION
+            || MT_STT_DAEMON_MAX_PAYLOAD < header.payload_size)
+        {
+            fprintf(stderr, "Error: Invalid request header!\n");
+            if(0 <= fd)
+            {
+                close(fd);
+            }
+            break;
+        }
+
+        payload.resize(header.payload_size);
+        if(!mt_stt_daemon_recv_all(sock, payload.data(), payload.size()))
+        {
+            if(0 <= fd)
+            {
+                close(fd);
+            }
+            break;
+        }
+
+        int const status = handle(header, fd, payload, response_payload);
+
+        if(0 <= fd)
+        {
+            close(fd);
+        }
+
+        struct mt_stt_daemon_response_header const response = {
+            MT_STT_DAEMON_MAGIC,
+            status,
+            (uint32_t)response_payload.size() };
+
+        if(!mt_stt_daemon_send(
+                sock, &response, sizeof response, response_payload, -1)
+            || status < 0)
+        {
+            break; // Protocol error or closed by the client.
+        }
+    }
+    close(sock);
+}
+
+int main(int argc, char* argv[])
+{
+    bool use_gpu = false;
+    std::vector<char const *> model_file_paths;
+
+    s_socket_path = getenv("MT_STT_DAEMON_SOCKET");
+    if(s_socket_path == nullptr)
+    {
+        s_socket_path = MT_STT_DAEMON_DEFAULT_SOCKET;
+    }
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string const name = argv[i];
+
+        if(name == "--gpu")
+        {
+            use_gpu = true;
+        }
+        else if(name == "--socket" && i + 1 < argc)
+        {
+            s_socket_path = argv[++i];
+        }
+        else if(name == "--model" && i + 1 < argc)
+        {
+            model_file_paths.push_back(argv[++i]);
+        }
+        else if(name == "--result-cache-mb" && i + 1 < argc)
+        {
+            s_result_cache_bytes = (size_t)atoi(argv[++i]) * 1024 * 1024;
+        }
+        else
+        {
+            fprintf(
+                stderr,
+                "Usage: %s [--socket <path>] [--gpu] [--model <file>]..."
+                " [--result-cache-mb <n>]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if(sizeof addr.sun_path <= strlen(s_socket_path))
+    {
+        fprintf(stderr, "Error: Socket path is too long!\n");
+        return 1;
+    }
+    strcpy(addr.sun_path, s_socket_path);
+
+    for(char const * const path : model_file_paths)
+    {
+        if(load_model_file(use_gpu, path) < 0)
+        {
+            return 1;
+        }
+    }
+
+    int const listen_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    unlink(s_socket_path); // From an earlier run, if any.
+    if(listen_sock < 0
+        || bind(listen_sock, (struct sockaddr *)&addr, sizeof addr) != 0
+        || listen(listen_sock, SOMAXCONN) != 0)
+    {
+        fprintf(
+            stderr,
+            "Error: Failed to listen at \"%s\" (%s)!\n",
+            s_socket_path,
+            strerror(errno));
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    fprintf(stderr, "Listening at \"%s\"..\n", s_socket_path);
+
+    while(true)
+    {
+        int const sock = accept4(listen_sock, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if(sock < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: accept() failed (%s)!\n", strerror(errno));
+            break;
+        }
+        std::thread(serve, sock).detach();
+    }
+
+    close(listen_sock);
+    unlink(s_socket_path);
+    return 1;
+}
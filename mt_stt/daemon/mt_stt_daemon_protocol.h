@@ -0,0 +1,422 @@
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Protocol between mt_stt_daemon and its client library (libmtstt_client.so),
+// via a Unix domain socket on the same machine (so all values are in the
+// byte order of the machine).
+//
+// - Each request is a header followed by its payload. Audio data (and model
+//   data) is NOT sent via the socket, but as file descriptor of a memfd
+//   attached to the header (SCM_RIGHTS).
+// - Each response is a header followed by its payload.
+// - A connection may be used for any number of requests, one after another.
+
+#ifndef MT_STT_DAEMON_PROTOCOL
+#define MT_STT_DAEMON_PROTOCOL
+
+#include "../mt_stt.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define MT_STT_DAEMON_MAGIC 0x4D545354u // "MTST"
+#define MT_STT_DAEMON_VERSION 1u
+
+// Used, if environment variable MT_STT_DAEMON_SOCKET is not set:
+//
+#define MT_STT_DAEMON_DEFAULT_SOCKET "/tmp/mt_stt_daemon.sock"
+
+// Max. size of a payload (the audio data is not part of it):
+//
+#define MT_STT_DAEMON_MAX_PAYLOAD (64u * 1024u * 1024u)
+
+enum mt_stt_daemon_op
+{
+    // Payload: u8 use_gpu, string model file path.
+    // Response: i32 model ID.
+    //
+    MT_STT_DAEMON_OP_LOAD_MODEL_FILE = 1,
+
+    // With memfd holding the model data.
+    // Payload: u8 use_gpu, u64 model data length.
+    // Response: i32 model ID.
+    //
+    MT_STT_DAEMON_OP_LOAD_MODEL_DATA = 2,
+
+    // With memfd holding the audio data.
+    // Payload: mt_stt_daemon_transcribe, string language, string initial
+    // prompt, string language cache key, i32 array prompt tokens, byte array
+    // decoding parameters, i32 array parts indices, i32 array parts limits.
+    // Response: string text, f32 array word probabilities, i32 array parts
+    // return value indices, u8 aborted, string language, f32 language
+    // probability, u8 has metrics [, mt_stt_metrics, string CPU variant,
+    // mt_stt_part_metrics array].
+    //
+    MT_STT_DAEMON_OP_TRANSCRIBE = 3,
+
+    // Payload: string preset name.
+    // Response: mt_stt_decoding_params.
+    //
+    MT_STT_DAEMON_OP_DECODING_PARAMS_INIT = 4
+};
+
+struct mt_stt_daemon_request_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t op; // See mt_stt_daemon_op.
+    uint32_t payload_size;
+};
+
+struct mt_stt_daemon_response_header
+{
+    uint32_t magic;
+    int32_t status; // 0 on success.
+    uint32_t payload_size;
+};
+
+/** Fixed-size part of the payload of MT_STT_DAEMON_OP_TRANSCRIBE (see
+ *  mt_stt_params for the fields with the same names).
+ */
+struct mt_stt_daemon_transcribe
+{
+    int32_t model_id;
+
+    // Audio data in the memfd, beginning at audio_offset. Mono, 32-bit float,
+    // 16 kHz samples, if sample_format is -1 (frame_count is the count of
+    // samples, then), otherwise see mt_stt_transcribe_pcm():
+    //
+    uint64_t audio_offset;
+    int32_t sample_format;
+    int32_t channels;
+    int32_t sample_rate;
+    int32_t frame_count;
+
+    int32_t n_threads;
+    uint8_t translate_to_en;
+    int32_t prompt_id;
+    int32_t parts_workers;
+    int32_t parts_context;
+    float vad_threshold_db;
+    float vad_min_energy_db;
+    int32_t vad_min_speech_ms;
+    int32_t vad_min_silence_ms;
+    int32_t vad_pad_ms;
+    uint8_t reduce_audio_ctx;
+    int32_t min_audio_ctx;
+    uint8_t detect_language_once;
+    int32_t detect_language_ms;
+    int32_t timeout_ms;
+    uint8_t return_partial_on_abort;
+
+    // Results wanted:
+    //
+    uint8_t word_probs;
+    uint8_t metrics;
+};
+
+// Writing a payload:
+
+template<typename T> static inline void mt_stt_daemon_put(
+    std::vector<char> & data_ref, T const val)
+{
+    data_ref.insert(
+        data_ref.end(), (char const *)&val, (char const *)&val + sizeof val);
+}
+
+static inline void mt_stt_daemon_put_bytes(
+    std::vector<char> & data_ref, void const * const bytes, size_t const len)
+{
+    data_ref.insert(
+        data_ref.end(), (char const *)bytes, (char const *)bytes + len);
+}
+
+/** Put the given string (NULL is supported).
+ */
+static inline void mt_stt_daemon_put_str(
+    std::vector<char> & data_ref, char const * const str)
+{
+    if(str == nullptr)
+    {
+        mt_stt_daemon_put<int32_t>(data_ref, -1);
+        return;
+    }
+
+    size_t const len = strlen(str);
+
+    mt_stt_daemon_put<int32_t>(data_ref, (int32_t)len);
+    mt_stt_daemon_put_bytes(data_ref, str, len);
+}
+
+/** Put the given array of n values (NULL is supported).
+ */
+template<typename T> static inline void mt_stt_daemon_put_arr(
+    std::vector<char> & data_ref, T const * const arr, int const n)
+{
+    if(arr == nullptr)
+    {
+        mt_stt_daemon_put<int32_t>(data_ref, -1);
+        return;
+    }
+    mt_stt_daemon_put<int32_t>(data_ref, (int32_t)n);
+    mt_stt_daemon_put_bytes(data_ref, arr, (size_t)n * sizeof *arr);
+}
+
+// Reading a payload (all functions return false, if the payload is too
+// short):
+
+struct mt_stt_daemon_reader
+{
+    char const * pos;
+    char const * end;
+};
+
+static inline bool mt_stt_daemon_get_bytes(
+    struct mt_stt_daemon_reader & reader_ref,
+    void * const out_bytes,
+    size_t const len)
+{
+    if((size_t)(reader_ref.end - reader_ref.pos) < len)
+    {
+        return false;
+    }
+    memcpy(out_bytes, reader_ref.pos, len);
+    reader_ref.pos += len;
+    return true;
+}
+
+template<typename T> static inline bool mt_stt_daemon_get(
+    struct mt_stt_daemon_reader & reader_ref, T & out_val)
+{
+    return mt_stt_daemon_get_bytes(reader_ref, &out_val, sizeof out_val);
+}
+
+/** Get a string put via mt_stt_daemon_put_str(), out_is_null is set to true
+ *  for NULL.
+ */
+static inline bool mt_stt_daemon_get_str(
+    struct mt_stt_daemon_reader & reader_ref,
+    std::string & out_str,
+    bool & out_is_null)
+{
+    int32_t len;
+
+    if(!mt_stt_daemon_get(reader_ref, len))
+    {
+        return false;
+    }
+    out_str.clear();
+    out_is_null = len < 0;
+    if(out_is_null)
+    {
+        return true;
+    }
+    if((size_t)(reader_ref.end - reader_ref.pos) < (size_t)len)
+    {
+        return false;
+    }
+    out_str.assign(reader_ref.pos, (size_t)len);
+    reader_ref.pos += len;
+    return true;
+}
+
+/** Get an array put via mt_stt_daemon_put_arr(), out_is_null is set to true
+ *  for NULL.
+ */
+template<typename T> static inline bool mt_stt_daemon_get_arr(
+    struct mt_stt_daemon_reader & reader_ref,
+    std::vector<T> & out_arr,
+    bool & out_is_null)
+{
+    int32_t n;
+
+    if(!mt_stt_daemon_get(reader_ref, n))
+    {
+        return false;
+    }
+    out_arr.clear();
+    out_is_null = n < 0;
+    if(out_is_null)
+    {
+        return true;
+    }
+    if((size_t)(reader_ref.end - reader_ref.pos) / sizeof(T) < (size_t)n)
+    {
+        return false;
+    }
+    out_arr.resize((size_t)n);
+    return mt_stt_daemon_get_bytes(
+        reader_ref, out_arr.data(), (size_t)n * sizeof(T));
+}
+
+// Sending and receiving (all functions return false on error):
+
+static inline bool mt_stt_daemon_send_all(
+    int const sock, void const * const data, size_t const len)
+{
+    char const * pos = (char const *)data;
+    size_t left = len;
+
+    while(0 < left)
+    {
+        ssize_t const n = send(sock, pos, left, MSG_NOSIGNAL);
+
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            return false;
+        }
+        pos += n;
+        left -= (size_t)n;
+    }
+    return true;
+}
+
+static inline bool mt_stt_daemon_recv_all(
+    int const sock, void * const data, size_t const len)
+{
+    char * pos = (char *)data;
+    size_t left = len;
+
+    while(0 < left)
+    {
+        ssize_t const n = recv(sock, pos, left, 0);
+
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            return false;
+        }
+        pos += n;
+        left -= (size_t)n;
+    }
+    return true;
+}
+
+/** Send the given header (with the given file descriptor attached, if >= 0)
+ *  and payload.
+ */
+static inline bool mt_stt_daemon_send(
+    int const sock,
+    void const * const header,
+    size_t const header_len,
+    std::vector<char> const & payload_ref,
+    int const opt_fd)
+{
+    struct iovec iov;
+    struct msghdr msg;
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    memset(&msg, 0, sizeof msg);
+    iov.iov_base = (void *)header;
+    iov.iov_len = header_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if(0 <= opt_fd)
+    {
+        memset(&control, 0, sizeof control);
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof control.buf;
+
+        struct cmsghdr * const cmsg = CMSG_FIRSTHDR(&msg);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &opt_fd, sizeof(int));
+    }
+
+    ssize_t n;
+
+    do
+    {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    }while(n < 0 && errno == EINTR);
+    if(n <= 0)
+    {
+        return false;
+    }
+    return mt_stt_daemon_send_all(
+            sock, (char const *)header + n, header_len - (size_t)n)
+        && mt_stt_daemon_send_all(
+            sock, payload_ref.data(), payload_ref.size());
+}
+
+/** Receive a header of the given length and the file descriptor attached to
+ *  it (out_fd is set to -1, if there is none, caller takes ownership).
+ */
+static inline bool mt_stt_daemon_recv_header(
+    int const sock, void * const header, size_t const header_len, int & out_fd)
+{
+    struct iovec iov;
+    struct msghdr msg;
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    out_fd = -1;
+
+    memset(&msg, 0, sizeof msg);
+    iov.iov_base = header;
+    iov.iov_len = header_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    ssize_t n;
+
+    do
+    {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    }while(n < 0 && errno == EINTR);
+    if(n <= 0)
+    {
+        return false;
+    }
+
+    for(struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+            && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        {
+            memcpy(&out_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    if(!mt_stt_daemon_recv_all(
+        sock, (char *)header + n, header_len - (size_t)n))
+    {
+        if(0 <= out_fd)
+        {
+            close(out_fd);
+            out_fd = -1;
+        }
+        return false;
+    }
+    return true;
+}
+
+#endif //MT_STT_DAEMON_PROTOCOL
@@ -8,28 +8,28 @@
 #endif //MT_EXPORT_STT
 
 #include "mt_stt.h"
+#include "mt_stt_internal.h"
 #include "whisper.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
-static char const * const s_log_file_path = "mt_stt_log.txt";
-
-// These are all to be initialized and de-initialized via mt_stt_transcribe():
+// Incremented by mt_stt_cancel(). Each transcription remembers the value at
+// its start and aborts, if it changes:
 //
-static FILE* s_log_file = nullptr;
-static void (*s_on_progress_func)(int progress) = nullptr;
-static bool s_aborted = false; // To be set to true by mt_stt_cancel(), only.
-static int s_parts_index = -1;
-static int s_parts_count = -1;
+static std::atomic<unsigned int> s_cancel_generation(0);
 
-/**
- * - Caller takes ownership of return value.
- */
-static char* create_copy(std::string const & str_ref)
+
+char* mt_stt_create_copy(std::string const & str_ref)
 {
     char* ret_val = nullptr;
     size_t const bytes = (str_ref.length() + 1) * sizeof *ret_val;
@@ -65,206 +65,382 @@ static char* create_copy(std::string const & str_ref)
 //    return str_ref.substr(start);
 //}
 
-static void on_log(ggml_log_level level, const char * text, void* user_data)
-{
-    if(s_log_file == nullptr)
-    {
-        return;
-    }
-
-    fputs(text, s_log_file);
-    fflush(s_log_file);
-}
-
 static void on_progress(
     struct whisper_context * ctx,
     struct whisper_state * state,
     int progress,
     void * user_data)
 {
-    assert(0 <= s_parts_index);
-    assert(s_parts_index < s_parts_count);
+    struct mt_stt_part const * const part =
+        (struct mt_stt_part const *)user_data;
+    struct mt_stt_request * const req = part->req;
 
-    int full_progress = progress;
+    assert(0 <= part->index);
+    assert(part->index < req->parts_count);
 
-    if(s_on_progress_func == nullptr)
+    if(req->on_progress_func == nullptr)
     {
         assert(false); // Should not get here.
         return;
     }
 
-    if(1 < s_parts_count)
+    std::lock_guard<std::mutex> const lock(req->progress_mutex);
+
+    req->parts_progress[part->index] = progress;
+
+    // E.g. (parts transcribed one after another):
+    //
+    // Index = 3
+    // Count = 5
+    // => 
+    // Full progress = (100 * 3 + progress) / 5
+    //
+    int full_progress = 0;
+
+    for(int const part_progress : req->parts_progress)
     {
-        // E.g.:
-        //
-        // Index = 3
-        // Count = 5
-        // => 
-        // Full progress = (100 * 3 + progress) / 5
-        //
-        full_progress = (100 * s_parts_index + progress) / s_parts_count;
+        full_progress += part_progress;
     }
+    full_progress /= req->parts_count;
+
+    //mt_stt_log_printf("full_progress: %d\n", full_progress);
+
+    req->on_progress_func(full_progress);
+}
 
-    //fprintf(s_log_file, "full_progress: %d\n", full_progress);
+void mt_stt_init_request(
+    struct mt_stt_request * const req,
+    struct mt_stt_params const & mt_params_ref,
+    int const parts_count)
+{
+    assert(0 < parts_count);
+
+    req->on_progress_func = mt_params_ref.on_progress_func;
+    req->on_segment_func = mt_params_ref.on_segment_func;
+    req->on_segment_user_data = mt_params_ref.on_segment_user_data;
+    req->cancel_generation = s_cancel_generation.load();
+    req->cancel_token = mt_params_ref.opt_cancel_token;
+    req->has_deadline = 0 < mt_params_ref.timeout_ms;
+    req->deadline = std::chrono::steady_clock::now()
+        + std::chrono::milliseconds(
+            req->has_deadline ? mt_params_ref.timeout_ms : 0);
+    req->return_partial = mt_params_ref.return_partial_on_abort;
+    req->result_cache = nullptr;
+    req->parts_count = parts_count;
+    req->min_audio_ctx = 0;
+    req->get_word_probs = false;
+    req->get_tokens = false;
+    mt_stt_get_guard(mt_params_ref.opt_decoding_params, req->guard);
+    if(mt_params_ref.reduce_audio_ctx)
+    {
+        req->min_audio_ctx =
+            0 < mt_params_ref.min_audio_ctx ? mt_params_ref.min_audio_ctx : 1;
+    }
+    req->parts_progress.assign(parts_count, 0);
+    req->failed = false;
+    req->aborted = false;
+    req->parts_metrics.resize(parts_count);
+}
 
-    s_on_progress_func(full_progress);
+bool mt_stt_is_aborted(struct mt_stt_request * const req)
+{
+    if(req->aborted)
+    {
+        return true;
+    }
+    if(s_cancel_generation.load() != req->cancel_generation
+        || (req->cancel_token != nullptr && req->cancel_token->cancelled)
+        || (req->has_deadline
+            && req->deadline <= std::chrono::steady_clock::now()))
+    {
+        req->aborted = true;
+        return true;
+    }
+    return false;
 }
 
 static bool on_is_abort(void * data)
 {
-    return s_aborted;
+    struct mt_stt_part const * const part = (struct mt_stt_part const *)data;
+
+    return part->req->failed || mt_stt_is_aborted(part->req)
+        || (part->degraded && part->req->guard.abort_part);
 }
 static bool on_encoder_begin(
     struct whisper_context * ctx,
     struct whisper_state * state,
     void * user_data)
 {
-    return !on_is_abort(nullptr);
+    mt_stt_guard_begin_window(state, (struct mt_stt_part *)user_data);
+    mt_stt_metrics_begin_window((struct mt_stt_part *)user_data);
+
+    return !on_is_abort(user_data);
+}
+
+static void on_logits_filter(
+    struct whisper_context * ctx,
+    struct whisper_state * state,
+    whisper_token_data const * tokens,
+    int n_tokens,
+    float * logits,
+    void * user_data)
+{
+    mt_stt_metrics_add_token((struct mt_stt_part *)user_data, n_tokens);
+    mt_stt_guard_check(
+        ctx, (struct mt_stt_part *)user_data, tokens, n_tokens, logits);
+}
+
+/** Give the new segments of the part's transcription to the request's
+ *  segment callback.
+ *
+ * * Hard-coded for a sample rate of 16000 Hz!
+ */
+static void on_new_segment(
+    struct whisper_context * ctx,
+    struct whisper_state * state,
+    int n_new,
+    void * user_data)
+{
+    struct mt_stt_part const * const part =
+        (struct mt_stt_part const *)user_data;
+    struct mt_stt_request * const req = part->req;
+    whisper_token const tok_eot = whisper_token_eot(ctx);
+    int const n_segments = whisper_full_n_segments_from_state(state);
+    long long const part_ms = part->audio_data_index / 16;
+    long long const part_end_ms =
+        (part->audio_data_index + part->audio_data_length) / 16;
+    std::vector<float> word_probs;
+
+    assert(req->on_segment_func != nullptr);
+
+    for(int i = std::max(0, n_segments - n_new); i < n_segments; ++i)
+    {
+        int const n_tokens = whisper_full_n_tokens_from_state(state, i);
+
+        word_probs.clear();
+        for(int j = 0; j < n_tokens; ++j)
+        {
+            whisper_token_data const data =
+                whisper_full_get_token_data_from_state(state, i, j);
+
+            if(tok_eot <= data.id)
+            {
+                continue; // Skip this special token.
+            }
+
+            // One probability per word (see get_result()):
+            //
+            if(std::isspace(
+                static_cast<unsigned char>(
+                    whisper_full_get_token_text_from_state(
+                        ctx, state, i, j)[0])))
+            {
+                word_probs.push_back(data.p);
+            }
+        }
+
+        struct mt_stt_new_segment segment;
+
+        segment.text = whisper_full_get_segment_text_from_state(state, i);
+        segment.t0_ms = std::min(
+            part_end_ms,
+            part_ms + 10LL * whisper_full_get_segment_t0_from_state(state, i));
+        segment.t1_ms = std::min(
+            part_end_ms,
+            part_ms + 10LL * whisper_full_get_segment_t1_from_state(state, i));
+        segment.part_index = part->index;
+        segment.word_probs = word_probs.empty() ? nullptr : word_probs.data();
+        segment.word_probs_count = (int)word_probs.size();
+
+        std::lock_guard<std::mutex> const lock(req->segment_mutex);
+
+        req->on_segment_func(&segment, req->on_segment_user_data);
+    }
 }
 
-/** Get the results from a transcription and optionally just ADD to the given
- *  word probabilities vector (that may not be empty, which is OK).
+/** Get the results from a transcription.
+ *
+ * - The word probabilities and the tokens and segments are retrieved, too, if
+ *   wanted by the request.
  */
-static std::string get_result_as_text(
-    struct whisper_context * const ctx, std::vector<float> * const word_probs)
+static void get_result(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    struct mt_stt_request const * const req,
+    struct mt_stt_part_result * const out_result)
 {
     whisper_token const tok_eot = whisper_token_eot(ctx);
+    int const n_segments = whisper_full_n_segments_from_state(state);
 
-    std::string ret_val = "";
+    out_result->text.clear();
+    out_result->word_probs.clear();
+    out_result->tokens.clear();
+    out_result->segments.clear();
 
-    for(int i = 0; i < whisper_full_n_segments(ctx); ++i)
+    for(int i = 0; i < n_segments; ++i)
     {
-        if(word_probs == nullptr) // <=> No probabilites wanted.
+        if(!req->get_word_probs && !req->get_tokens)
         {
-            ret_val += whisper_full_get_segment_text(ctx, i);
+            out_result->text +=
+                whisper_full_get_segment_text_from_state(state, i);
             continue;
         }
 
-        // Caller wants the probability for each word.
+        // Caller wants the probability for each word and/or the tokens.
+
+        struct mt_stt_part_segment segment;
+        int const n_tokens = whisper_full_n_tokens_from_state(state, i);
+
+        segment.t0 = whisper_full_get_segment_t0_from_state(state, i);
+        segment.t1 = whisper_full_get_segment_t1_from_state(state, i);
+        segment.token_index = (int)out_result->tokens.size();
 
-        for(int j = 0; j < whisper_full_n_tokens(ctx, i); ++j)
+        for(int j = 0; j < n_tokens; ++j)
         {
+            whisper_token_data const data =
+                whisper_full_get_token_data_from_state(state, i, j);
+
 #ifndef NDEBUG
-            fprintf(
-                s_log_file,
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_DEBUG,
                 "%d;%d;\"%s\";%f;\n",
                 i,
                 j,
-                whisper_full_get_token_text(ctx, i, j),
-                whisper_full_get_token_p(ctx, i, j));
+                whisper_full_get_token_text_from_state(ctx, state, i, j),
+                data.p);
 #endif //NDEBUG
 
-            if(tok_eot <= whisper_full_get_token_id(ctx, i, j))
+            if(tok_eot <= data.id)
             {
                 continue; // Skip this special token.
             }
 
-            std::string const tok_text = whisper_full_get_token_text(ctx, i, j);
-
-            ret_val += tok_text;
+            char const * const tok_text =
+                whisper_full_get_token_text_from_state(ctx, state, i, j);
 
             // We want one probability per word. If a token starts with a
             // whitespace, it is interpreted as the beginning of a word, here:
             //
-            assert(0 < tok_text.length());
-            if(std::isspace(static_cast<unsigned char>(tok_text[0])))
+            assert(tok_text[0] != '\0');
+            if(req->get_word_probs
+                && std::isspace(static_cast<unsigned char>(tok_text[0])))
             {
                 // Just using the probability of the word's first token as
                 // the (whole) word's probability:
                 //
-                word_probs->push_back(whisper_full_get_token_p(ctx, i, j));
+                out_result->word_probs.push_back(data.p);
+            }
+
+            if(req->get_tokens)
+            {
+                struct mt_stt_part_token token;
+
+                token.id = data.id;
+                token.p = data.p;
+                token.t0 = data.t0;
+                token.t1 = data.t1;
+                token.text_index = out_result->text.length();
+
+                out_result->text += tok_text;
+
+                token.text_length =
+                    out_result->text.length() - token.text_index;
+                out_result->tokens.push_back(token);
+                continue;
             }
+            out_result->text += tok_text;
+        }
+
+        segment.token_count =
+            (int)out_result->tokens.size() - segment.token_index;
+        if(req->get_tokens)
+        {
+            out_result->segments.push_back(segment);
         }
     }
-    return ret_val;
 }
 
-static char* transcribe(
+/** Load a Whisper model either from file (if model_file_path is not NULL) or
+ *  from the given memory buffer.
+ *
+ * - The returned context has no Whisper state, see mt_stt_acquire_state().
+ * - Logs to the log file (which must be open, already).
+ * - Returns NULL on error.
+ */
+static struct whisper_context * load_ctx(
     bool const use_gpu,
-    int const n_threads,
-    char const * const language,
-    bool const translate_to_en,
-    char const * const initial_prompt,
-    char * const model_file_path,
+    char const * const model_file_path,
     void * const model_data,
-    size_t const model_data_len,
-    float const * const audio_data_arr,
-    int const audio_data_length,
-    void (*on_progress_func)(int progress),
-    float * * const opt_out_word_probs,
-    int * opt_out_word_probs_count,
-    int * const opt_out_parts_ret_val_indices,
-    int const * const opt_parts_audio_data_indices,
-    int const * const opt_parts_audio_data_limits,
-    int const opt_parts_length)
+    size_t const model_data_len)
 {
-    assert(
-        (opt_out_word_probs == nullptr)
-            == (opt_out_word_probs_count == nullptr));
-
     assert(
         (model_file_path == nullptr
             && model_data != nullptr && 0 < model_data_len)
         || (model_file_path != nullptr
-                && model_data == nullptr && model_data_len == -1));
+                && model_data == nullptr && model_data_len == (size_t)-1));
 
-    assert(
-        (opt_out_parts_ret_val_indices == nullptr
-            && opt_parts_audio_data_indices == nullptr
-            && opt_parts_audio_data_limits == nullptr
-            && opt_parts_length == 0)
-        || (opt_out_parts_ret_val_indices != nullptr
-            && opt_parts_audio_data_indices != nullptr
-            && opt_parts_audio_data_limits != nullptr
-            && 0 < opt_parts_length));
+    whisper_context_params ctx_p = whisper_context_default_params();
 
-    std::string buf;
-    whisper_context_params ctx_p;
-    struct whisper_full_params params;
-    std::vector<float> word_probs;
-    std::vector<whisper_token> prompt_tokens;
+    mt_stt_log_printf(MT_STT_LOG_LEVEL_INFO, "use_gpu = %d\n", (int)use_gpu);
 
-    whisper_log_set(on_log, NULL);
-    assert(s_log_file == nullptr);
+    ctx_p.use_gpu = use_gpu;
 
-#ifdef _WIN32
-    s_log_file = _fsopen(s_log_file_path, "a", SH_DENYWR);
-#else //_WIN32
-    s_log_file = fopen(s_log_file_path, "a");
-#endif //_WIN32
-    if(s_log_file == nullptr)
+    return model_file_path == nullptr
+        ? whisper_init_from_buffer_with_params_no_state(
+            model_data, model_data_len, ctx_p)
+        : whisper_init_from_file_with_params_no_state(model_file_path, ctx_p);
+}
+
+struct whisper_state * mt_stt_acquire_state(struct mt_stt_model * const model)
+{
     {
-        return nullptr;
+        std::lock_guard<std::mutex> const lock(model->states_mutex);
+
+        if(!model->idle_states.empty())
+        {
+            struct whisper_state * const ret_val = model->idle_states.back();
+
+            model->idle_states.pop_back();
+            return ret_val;
+        }
     }
-    assert(s_log_file != nullptr);
 
-    // Print given parameters:
+    // Creating a new state (allocating its buffers) takes some time, so this
+    // is done without holding the lock:
     //
-//#ifndef NDEBUG
-    fprintf(s_log_file, "use_gpu = %d\n", (int)use_gpu);
-    fprintf(s_log_file, "n_threads = %d\n", n_threads);
-    fprintf(
-        s_log_file,
-        "language = \"%s\"\n",
-        language == NULL ? "(null)" : language);
-    fprintf(s_log_file, "translate_to_en = %d\n", (int)translate_to_en);
-    fprintf(
-        s_log_file,
-        "initial_prompt = \"%s\"\n",
-        initial_prompt == NULL ? "(null)" : initial_prompt);
-//#endif //NDEBUG
+    return whisper_init_state(model->ctx);
+}
 
-    ctx_p = whisper_context_default_params();
-    ctx_p.use_gpu = use_gpu;
+void mt_stt_release_state(
+    struct mt_stt_model * const model, struct whisper_state * const state)
+{
+    std::lock_guard<std::mutex> const lock(model->states_mutex);
+
+    model->idle_states.push_back(state);
+}
+
+bool mt_stt_init_full_params(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    struct whisper_full_params & params,
+    std::vector<whisper_token> & prompt_tokens)
+{
+    int const n_threads = mt_params_ref.n_threads;
+    char const * const language = mt_params_ref.language;
+    bool const translate_to_en = mt_params_ref.translate_to_en;
+
+    struct mt_stt_decoding_params decoding;
+
+    if(!mt_stt_get_decoding_params(
+            mt_params_ref.opt_decoding_params, decoding))
+    {
+        return false;
+    }
 
-    struct whisper_context * const ctx = model_file_path == nullptr
-            ? whisper_init_from_buffer_with_params(
-                model_data, model_data_len, ctx_p)
-            : whisper_init_from_file_with_params(model_file_path, ctx_p);
-    
     params = whisper_full_default_params(
-       WHISPER_SAMPLING_GREEDY);
-       //WHISPER_SAMPLING_BEAM_SEARCH); // Does not seem to do any magic.
+        decoding.strategy == MT_STT_SAMPLING_BEAM_SEARCH
+            ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+    mt_stt_apply_decoding_params(decoding, params);
 
     if(0 < n_threads)
     {
@@ -273,66 +449,31 @@ static char* transcribe(
     //
     // Otherwise: Will be set based on hardware.
 
-    // Manually creating tokens from initial prompt (if given), to be able to
-    // abort, if initial prompt is too long [see whisper_full_with_state()]:
+    // Manually giving tokens of initial prompt (if given), to be able to
+    // abort, if initial prompt is too long [see whisper_full_with_state()]
+    // and to tokenize each prompt once, only (see mt_stt_prompt.cpp):
     //
-    if(initial_prompt != nullptr && 0 < strlen(initial_prompt))
+    if(!mt_stt_get_prompt_tokens(model, mt_params_ref, prompt_tokens))
+    {
+        return false;
+    }
+    if(!prompt_tokens.empty())
     {
         assert(params.prompt_tokens == nullptr);
         assert(params.prompt_n_tokens == 0);
 
-        int n_needed = 0;
-
-        prompt_tokens.resize(1024);
-        
-        n_needed = whisper_tokenize(
-            ctx,
-            initial_prompt,
-            prompt_tokens.data(),
-            static_cast<int>(prompt_tokens.size()));
-        if(n_needed < 0)
-        {
-            prompt_tokens.resize(-n_needed);
-
-            n_needed = whisper_tokenize(
-                ctx,
-                initial_prompt,
-                prompt_tokens.data(),
-                static_cast<int>(prompt_tokens.size()));
-        }
-
-        int const max_initial_prompt_tokens = whisper_n_text_ctx(ctx) / 2;
-
-#ifndef NDEBUG
-        fprintf(
-            s_log_file,
-            "max_initial_prompt_tokens: %d; n_needed: %d\n",
-            max_initial_prompt_tokens,
-            n_needed);
-#endif //NDEBUG
-
-        if(max_initial_prompt_tokens < n_needed)
-        {
-            fprintf(
-                s_log_file,
-                "Error: Initial prompt is too long (%d tokens, max. is %d tokens)!\n",
-                n_needed,
-                max_initial_prompt_tokens);
-            whisper_free(ctx);
-            fclose(s_log_file);
-            s_log_file = nullptr;
-            return nullptr;
-        }
-
-        prompt_tokens.resize(n_needed);
-        
-        params.initial_prompt = initial_prompt; // Probably not necessary.
+        // Probably not necessary:
+        //
+        params.initial_prompt = mt_params_ref.initial_prompt;
         params.prompt_tokens = prompt_tokens.data();
         params.prompt_n_tokens = static_cast<int>(prompt_tokens.size());
     }
 
     params.translate = translate_to_en;
     params.no_context = false; // Keep context between parts (if given).
+    //
+    // (overridden per part, see mt_stt_transcribe_part() and
+    // mt_stt_parts_context)
     params.language = language;
     params.detect_language = false; // This leads to "just" detecting the language, as it seems.
     params.suppress_blank = true;
@@ -341,203 +482,897 @@ static char* transcribe(
     //params.print_special = true/*false*/; // Must be implemented manually.
     //params.print_progress = true/*false*/;
 
-    assert(s_on_progress_func == nullptr);
-    if(on_progress_func != nullptr)
+    return true;
+}
+
+/** Get the (reduced) encoder context to use for the given count of samples.
+ *
+ * - Returns 0 for the full context (default of Whisper).
+ * - Hard-coded for a sample rate of 16000 Hz (20 ms per encoder position)!
+ */
+static int get_audio_ctx(
+    struct whisper_context * const ctx,
+    int const min_audio_ctx,
+    int const audio_data_length)
+{
+    // Some margin, because the decoder tends to miss the last words, if the
+    // audio data ends right at the end of the context:
+    //
+    static int const margin = 64; // 1.28 seconds.
+
+    int const n_audio_ctx = whisper_n_audio_ctx(ctx);
+    int const needed = (audio_data_length + 320 - 1) / 320 + margin;
+
+    if(n_audio_ctx <= needed || n_audio_ctx <= min_audio_ctx)
     {
-        s_on_progress_func = on_progress_func;
+        return 0;
+    }
+    return needed < min_audio_ctx ? min_audio_ctx : needed;
+}
 
+bool mt_stt_transcribe_part(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    struct whisper_full_params params, // (copied on purpose)
+    struct mt_stt_part * const part,
+    bool const no_context,
+    bool const pad,
+    float const * part_audio_data,
+    int part_audio_data_length,
+    struct mt_stt_part_result * const out_result)
+{
+    if(part->req->on_progress_func != nullptr)
+    {
         params.progress_callback = on_progress;
-        //params.progress_callback_user_data;
+        params.progress_callback_user_data = part;
     }
-    assert(s_parts_count == -1);
-    s_parts_count = opt_parts_length != 0 ? opt_parts_length : 1;
 
     params.abort_callback = on_is_abort;
-    params.abort_callback_user_data = nullptr;
+    params.abort_callback_user_data = part;
     //
     params.encoder_begin_callback = on_encoder_begin;
-    params.encoder_begin_callback_user_data = nullptr;
+    params.encoder_begin_callback_user_data = part;
+    //
+    params.logits_filter_callback = on_logits_filter;
+    params.logits_filter_callback_user_data = part;
 
-    fprintf(s_log_file, "%s\n", whisper_print_system_info());
+    if(part->req->on_segment_func != nullptr)
+    {
+        params.new_segment_callback = on_new_segment;
+        params.new_segment_callback_user_data = part;
+    }
 
-    whisper_reset_timings(ctx);
+    params.no_context = no_context;
+    params.token_timestamps = part->req->get_tokens;
 
-    bool const get_word_probs = opt_out_word_probs != nullptr;
+    part->degraded = false;
+    part->window_audio_length = part->audio_data_length;
 
-    assert(s_parts_index == -1);
-    if(opt_out_parts_ret_val_indices == nullptr) // => One single "part".
+    // Pad audio data, if less than a second (necessary for Whisper):
+    //
+    // * Hard-coded for a sample rate of 16000 Hz!
+    //
+    static int const min_audio_data_len = 16000 + 384;
+    static thread_local std::vector<float> min_buf; // Reused per thread.
+    //
+    if(pad && part_audio_data_length < min_audio_data_len)
     {
-        s_parts_index = 0;
+        min_buf.assign(min_audio_data_len, 0.0f);
+        std::copy(
+            part_audio_data,
+            part_audio_data + part_audio_data_length,
+            min_buf.begin());
+        part_audio_data = min_buf.data();
+        part_audio_data_length = min_audio_data_len;
+    }
 
-        if(whisper_full(ctx, params, audio_data_arr, audio_data_length) != 0)
-        {
-            whisper_free(ctx);
-            s_on_progress_func = nullptr;
-            s_parts_count = -1;
-            s_parts_index = -1;
-            fclose(s_log_file);
-            s_log_file = nullptr;
-            return nullptr;
-        }
-        buf = get_result_as_text(ctx, get_word_probs ? &word_probs : nullptr);
+    if(0 < part->req->min_audio_ctx)
+    {
+        params.audio_ctx = get_audio_ctx(
+            ctx, part->req->min_audio_ctx, part_audio_data_length);
     }
-    else // => Transcribe given parts of the audio data, only.
+
+    mt_stt_metrics_begin_part(part, part_audio_data_length);
+
+    std::string cache_key;
+
+    if(part->req->result_cache != nullptr)
     {
-        buf = "";
-        for(int i = 0; i < opt_parts_length; ++i) // Transcribe each given part.
+        assert(no_context); // Otherwise, the result depends on the context.
+
+        mt_stt_cache_get_key(
+            params,
+            part->req->guard,
+            part_audio_data,
+            part_audio_data_length,
+            cache_key);
+        if(mt_stt_cache_get(
+                *part->req->result_cache, cache_key, part->req, out_result))
         {
-            s_parts_index = i;
-
-            // 0 1 2 3 4 5 6 7 8 9
-            //     ^             ^
-            //     |             |
-            //     index         limit
-            // 
-            // length = limit - index = 9 - 2 = 7
-
-            int const part_audio_index = opt_parts_audio_data_indices[i];
-            float const * part_audio_data =
-                    audio_data_arr + part_audio_index;
-            int part_audio_data_length =
-                    opt_parts_audio_data_limits[i] - part_audio_index;
-
-            // Pad audio data, if less than a second (necessary for Whisper):
-            //
-            // * Hard-coded for a sample rate of 16000 Hz!
-            //            
-            static int const min_audio_data_len = 16000 + 384;
-            float* min_buf = nullptr;
-            //
-            if(part_audio_data_length < min_audio_data_len)
+            part->degraded = out_result->degraded;
+            mt_stt_metrics_cache_hit(part);
+            mt_stt_metrics_end_part(part);
+            if(part->req->on_progress_func != nullptr)
             {
-                min_buf = (float*)malloc(min_audio_data_len * sizeof * min_buf);
+                on_progress(ctx, state, 100, part);
+            }
+            return true; // Whisper (and the state) not used.
+        }
+    }
 
-                assert(min_buf != nullptr);
+    int result = -1;
+    bool const ran = mt_stt_pool_run(
+        part->req,
+        params.n_threads,
+        [&](int const n_threads)
+        {
+            params.n_threads = n_threads;
+            result = whisper_full_with_state(
+                ctx, state, params, part_audio_data, part_audio_data_length);
+        });
 
-                for(int j = 0; j < min_audio_data_len; ++j)
-                {
-                    min_buf[j] = 0.0f;
+    mt_stt_metrics_end_part(part);
 
-                    if(j < part_audio_index)
-                    {
-                        min_buf[j] = part_audio_data[j];
-                    }
-                }
-                part_audio_data = min_buf;
-                part_audio_data_length = min_audio_data_len;
-            }
+    if(!ran)
+    {
+        // Aborted while waiting for the thread pool, the state holds no
+        // results of this part (but maybe of an earlier transcription):
+        //
+        return part->req->return_partial;
+    }
 
-            if(whisper_full(
-                ctx, params, part_audio_data, part_audio_data_length)
-                    != 0)
-            {
-                part_audio_data = nullptr;
-                part_audio_data_length = 0;
-                if(min_buf != nullptr)
-                {
-                    free(min_buf);
-                    min_buf = nullptr;
-                }
+    part_audio_data = nullptr;
+    part_audio_data_length = 0;
 
-                whisper_free(ctx);
-                s_on_progress_func = nullptr;
-                s_parts_count = -1;
-                s_parts_index = -1;
-                fclose(s_log_file);
-                s_log_file = nullptr;
-                return nullptr;
-            }
+    if(part->req->aborted)
+    {
+        // Whisper may return without an error, if aborted before encoding a
+        // window. The segments of the windows done before are still
+        // available via the state in any case:
+        //
+        if(!part->req->return_partial)
+        {
+            return false;
+        }
+    }
+    else if(result != 0)
+    {
+        // Whisper fails, if the guard stopped the part while decoding. The
+        // segments of the windows done before are available, as above:
+        //
+        if(!(part->degraded && part->req->guard.abort_part))
+        {
+            return false;
+        }
+    }
 
-            part_audio_data = nullptr;
-            part_audio_data_length = 0;
-            if(min_buf != nullptr)
-            {
-                free(min_buf);
-                min_buf = nullptr;
-            }
+    get_result(ctx, state, part->req, out_result);
+    out_result->degraded = part->degraded;
 
-            std::string const cur_text = get_result_as_text(
-                ctx, get_word_probs ? &word_probs : nullptr);
+    if(part->req->result_cache != nullptr && !part->req->aborted)
+    {
+        mt_stt_cache_put(
+            *part->req->result_cache, cache_key, part->req, *out_result);
+    }
 
-            //fprintf(
-            //    s_log_file,
-            //    "CUR_TEXT AT %d: \"%s\"\n",
-            //    (int)buf.length(),
-            //    cur_text.c_str());
+    //mt_stt_log_printf(
+    //    "CUR_TEXT OF PART %d: \"%s\"\n",
+    //    part->index,
+    //    out_result->text.c_str());
 
-            opt_out_parts_ret_val_indices[i] = -1;
-            if(cur_text.length() != 0)
-            {
-                opt_out_parts_ret_val_indices[i] = (int)buf.length();
+    return true;
+}
 
-                buf += cur_text;
-            }
-        }
+/** Transcribe the parts with the given indices one after another, each worker
+ *  calling this function uses its own state.
+ *
+ * - If next_index is not NULL, it is used to get the index of the next part to
+ *   transcribe (shared by all workers) and first and limit are ignored.
+ *   Otherwise the parts from first to limit (exclusive) are transcribed.
+ * - Context is kept from one part to the next, if keep_context is true.
+ */
+static void transcribe_parts_worker(
+    struct mt_stt_model * const model,
+    struct whisper_full_params const & params_ref,
+    struct mt_stt_request * const req,
+    std::atomic<int> * const next_index,
+    int const first,
+    int const limit,
+    bool const keep_context,
+    float const * const audio_data_arr,
+    int const * const parts_audio_data_indices,
+    int const * const parts_audio_data_limits,
+    std::vector<struct mt_stt_part_result> & results_ref)
+{
+    struct whisper_state * const state = mt_stt_acquire_state(model);
+
+    if(state == nullptr)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Failed to create Whisper state!\n");
+        req->failed = true;
+        return;
     }
 
-    whisper_print_timings(ctx);
-    
-    if(get_word_probs)
+    for(int i = first;; ++i)
     {
-        *opt_out_word_probs = nullptr;
-        *opt_out_word_probs_count = 0;
-        if(!word_probs.empty())
+        if(next_index != nullptr)
         {
-            size_t const bytes =
-                word_probs.size() * sizeof **opt_out_word_probs;
-
-            *opt_out_word_probs = (float*)malloc(bytes);
-            if(*opt_out_word_probs == nullptr)
+            i = (*next_index)++;
+            if(req->parts_count <= i)
             {
-                whisper_free(ctx);
-                s_on_progress_func = nullptr;
-                s_parts_count = -1;
-                s_parts_index = -1;
-                fclose(s_log_file);
-                s_log_file = nullptr;
-                return nullptr; // Must not get here.
+                break;
             }
+        }
+        else if(limit <= i)
+        {
+            break;
+        }
 
-            *opt_out_word_probs_count = (int)word_probs.size();
-            for(int i = 0; i < *opt_out_word_probs_count; ++i)
-            {
-                *((*opt_out_word_probs) + i) = word_probs[i];
-            }
+        if(req->failed)
+        {
+            break; // Another worker failed.
+        }
+        if(mt_stt_is_aborted(req))
+        {
+            break; // The results of the parts left stay empty.
         }
-    }
 
-    //fprintf(
-    //    s_log_file,
-    //    "CONTENT OF buf BEFORE RETURN: \"%s\"\n",
-    //    buf.c_str());
+        // 0 1 2 3 4 5 6 7 8 9
+        //     ^             ^
+        //     |             |
+        //     index         limit
+        // 
+        // length = limit - index = 9 - 2 = 7
 
-    whisper_free(ctx);
-    s_on_progress_func = nullptr;
-    s_parts_count = -1;
-    s_parts_index = -1;
-    fclose(s_log_file);
-    s_log_file = nullptr;
+        struct mt_stt_part part;
 
-    return create_copy(buf);
-}
+        part.req = req;
+        part.index = i;
+        part.audio_data_index = parts_audio_data_indices[i];
+        part.audio_data_length =
+            parts_audio_data_limits[i] - parts_audio_data_indices[i];
 
-MT_EXPORT_STT_API void __stdcall mt_stt_free(void * const ptr)
-{
-    free(ptr);
-}
+        // The (maybe reused) state holds the context of its last
+        // transcription, which must not be used for the first part:
+        //
+        if(!mt_stt_transcribe_part(
+                model->ctx,
+                state,
+                params_ref,
+                &part,
+                !keep_context || i == first,
+                true,
+                audio_data_arr + parts_audio_data_indices[i],
+                parts_audio_data_limits[i] - parts_audio_data_indices[i],
+                &results_ref[i]))
+        {
+            req->failed = true;
+            break;
+        }
+    }
 
-MT_EXPORT_STT_API void __stdcall mt_stt_cancel()
-{
-    s_aborted = true;
+    mt_stt_release_state(model, state);
 }
 
-MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_file(
-    bool const use_gpu,
-    int const n_threads,
-    char const * const language,
-    bool const translate_to_en,
+/** Transcribe all given parts, maybe by multiple workers at the same time (see
+ *  mt_stt_params).
+ *
+ * - Returns false on error.
+ */
+static bool transcribe_parts(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    struct whisper_full_params const & params_ref,
+    struct mt_stt_request * const req,
+    float const * const audio_data_arr,
+    int const * const parts_audio_data_indices,
+    int const * const parts_audio_data_limits,
+    std::vector<struct mt_stt_part_result> & results_ref)
+{
+    int const parts_count = req->parts_count;
+    int workers = mt_params_ref.parts_workers;
+    std::atomic<int> next_index(0);
+    std::vector<int> firsts; // First part index of each worker.
+    std::vector<std::thread> threads;
+
+    if(mt_params_ref.parts_context == MT_STT_PARTS_CONTEXT_FULL
+        || workers < 1)
+    {
+        workers = 1;
+    }
+    if(parts_count < workers)
+    {
+        workers = parts_count;
+    }
+
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "parts: %d; workers: %d; context: %d\n",
+        parts_count,
+        workers,
+        (int)mt_params_ref.parts_context);
+
+    if(mt_params_ref.parts_context != MT_STT_PARTS_CONTEXT_NONE)
+    {
+        // Each worker gets a contiguous range of parts with about the same
+        // amount of audio data, to be able to keep the context between them:
+
+        long long total_len = 0;
+
+        for(int i = 0; i < parts_count; ++i)
+        {
+            total_len +=
+                parts_audio_data_limits[i] - parts_audio_data_indices[i];
+        }
+
+        long long len = 0;
+
+        firsts.push_back(0);
+        for(int i = 0; i < parts_count
+            && (int)firsts.size() < workers; ++i)
+        {
+            len += parts_audio_data_limits[i] - parts_audio_data_indices[i];
+
+            // Start the next range behind this part, if this range holds its
+            // share of the audio data and enough parts are left:
+            //
+            if(total_len * (long long)firsts.size() <= len * workers
+                && workers - (int)firsts.size() <= parts_count - (i + 1))
+            {
+                firsts.push_back(i + 1);
+            }
+        }
+        while((int)firsts.size() < workers) // (should not be necessary)
+        {
+            firsts.push_back(parts_count);
+        }
+    }
+
+    auto const work = [&](int const w)
+        {
+            if(firsts.empty()) // => No context, take the next part available.
+            {
+                transcribe_parts_worker(
+                    model,
+                    params_ref,
+                    req,
+                    &next_index,
+                    0,
+                    parts_count,
+                    false,
+                    audio_data_arr,
+                    parts_audio_data_indices,
+                    parts_audio_data_limits,
+                    results_ref);
+                return;
+            }
+            transcribe_parts_worker(
+                model,
+                params_ref,
+                req,
+                nullptr,
+                firsts[w],
+                w + 1 < workers ? firsts[w + 1] : parts_count,
+                true,
+                audio_data_arr,
+                parts_audio_data_indices,
+                parts_audio_data_limits,
+                results_ref);
+        };
+
+    for(int w = 1; w < workers; ++w)
+    {
+        threads.emplace_back(work, w);
+    }
+    work(0); // The calling thread is the first worker.
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return !req->failed;
+}
+
+bool mt_stt_transcribe_results(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    bool const get_word_probs,
+    bool const get_tokens,
+    std::vector<struct mt_stt_part_result> & out_results)
+{
+    assert(model != nullptr);
+
+    assert(
+        (opt_parts_audio_data_indices == nullptr
+            && opt_parts_audio_data_limits == nullptr
+            && opt_parts_length == 0)
+        || (opt_parts_audio_data_indices != nullptr
+            && opt_parts_audio_data_limits != nullptr
+            && 0 < opt_parts_length));
+
+    int const n_threads = mt_params_ref.n_threads;
+    char const * const language = mt_params_ref.language;
+    bool const translate_to_en = mt_params_ref.translate_to_en;
+    char const * const initial_prompt = mt_params_ref.initial_prompt;
+    struct whisper_context * const ctx = model->ctx;
+    struct whisper_full_params params;
+    std::vector<whisper_token> prompt_tokens;
+    struct mt_stt_request req;
+    auto const start = std::chrono::steady_clock::now();
+
+    mt_stt_open_log();
+
+    // Print given parameters:
+    //
+//#ifndef NDEBUG
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO, "n_threads = %d\n", n_threads);
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "language = \"%s\"\n", language == NULL ? "(null)" : language);
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "translate_to_en = %d\n",
+        (int)translate_to_en);
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "initial_prompt = \"%s\"\n",
+        initial_prompt == NULL ? "(null)" : initial_prompt);
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "prompt_n_tokens = %d; prompt_id = %d\n",
+        mt_params_ref.prompt_tokens == nullptr
+            ? -1 : mt_params_ref.prompt_n_tokens,
+        mt_params_ref.prompt_id);
+//#endif //NDEBUG
+
+    if(mt_params_ref.opt_out_aborted != nullptr)
+    {
+        *mt_params_ref.opt_out_aborted = false;
+    }
+
+    // (the timeout starts here)
+    //
+    mt_stt_init_request(
+        &req, mt_params_ref, opt_parts_length != 0 ? opt_parts_length : 1);
+    req.get_word_probs = get_word_probs;
+    req.get_tokens = get_tokens;
+    if(0 < model->result_cache.max_bytes.load()
+        && req.on_segment_func == nullptr // (a cache hit has no segments)
+        && (opt_parts_audio_data_indices == nullptr
+            || mt_params_ref.parts_context == MT_STT_PARTS_CONTEXT_NONE))
+    {
+        req.result_cache = &model->result_cache;
+    }
+
+    if(!mt_stt_init_full_params(model, mt_params_ref, params, prompt_tokens))
+    {
+        mt_stt_close_log();
+        return false;
+    }
+
+    char const * detected_language = nullptr;
+
+    if(!mt_stt_detect_language(
+            model,
+            nullptr,
+            mt_params_ref,
+            params.n_threads,
+            audio_data_arr,
+            audio_data_length,
+            opt_parts_audio_data_indices,
+            opt_parts_audio_data_limits,
+            opt_parts_length,
+            detected_language))
+    {
+        mt_stt_close_log();
+        return false;
+    }
+    if(detected_language != nullptr)
+    {
+        params.language = detected_language; // Same for all parts.
+    }
+
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO, "%s\n", whisper_print_system_info());
+
+    out_results.resize(req.parts_count);
+
+    bool ok = false;
+
+    if(opt_parts_audio_data_indices == nullptr) // => One single "part".
+    {
+        struct whisper_state * const state = mt_stt_acquire_state(model);
+
+        if(state == nullptr)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Failed to create Whisper state!\n");
+            mt_stt_close_log();
+            return false;
+        }
+
+        struct mt_stt_part part;
+
+        part.req = &req;
+        part.index = 0;
+        part.audio_data_index = 0;
+        part.audio_data_length = audio_data_length;
+
+        // The (maybe reused) state holds the context of its last
+        // transcription, which must not be used:
+        //
+        ok = mt_stt_transcribe_part(
+            ctx,
+            state,
+            params,
+            &part,
+            true,
+            false,
+            audio_data_arr,
+            audio_data_length,
+            &out_results[0]);
+
+        mt_stt_release_state(model, state);
+    }
+    else // => Transcribe given parts of the audio data, only.
+    {
+        ok = transcribe_parts(
+            model,
+            mt_params_ref,
+            params,
+            &req,
+            audio_data_arr,
+            opt_parts_audio_data_indices,
+            opt_parts_audio_data_limits,
+            out_results);
+    }
+
+    if(req.aborted)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN,
+            "Transcription aborted (%s).\n",
+            ok ? "returning partial result" : "no result");
+    }
+    if(mt_params_ref.opt_out_aborted != nullptr)
+    {
+        *mt_params_ref.opt_out_aborted = req.aborted;
+    }
+    if(!ok)
+    {
+        mt_stt_close_log();
+        return false;
+    }
+
+    double const total_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    struct mt_stt_metrics metrics;
+
+    if(!mt_stt_metrics_get(
+            model,
+            req,
+            total_ms,
+            mt_params_ref.opt_out_metrics != nullptr
+                && opt_parts_audio_data_indices != nullptr,
+            &metrics))
+    {
+        mt_stt_close_log();
+        return false; // Must not get here.
+    }
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "total_ms = %.1f; rtf = %.3f; mel_ms = %.1f; encode_ms = %.1f;"
+            " decode_ms = %.1f; encoder_runs = %d; tokens = %d;"
+            " fallbacks = %d; cache_hits = %d\n",
+        metrics.total_ms,
+        metrics.rtf,
+        metrics.mel_ms,
+        metrics.encode_ms,
+        metrics.decode_ms,
+        metrics.encoder_runs,
+        metrics.tokens,
+        metrics.fallbacks,
+        metrics.cache_hits);
+    if(mt_params_ref.opt_out_metrics != nullptr)
+    {
+        *mt_params_ref.opt_out_metrics = metrics;
+    }
+
+    mt_stt_close_log();
+    return true;
+}
+
+/**
+ * - Does NOT take ownership of the given model, which may be used for any
+ *   number of transcriptions (also at the same time).
+ */
+static char* transcribe(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    assert(
+        (opt_out_word_probs == nullptr)
+            == (opt_out_word_probs_count == nullptr));
+
+    assert(
+        (opt_out_parts_ret_val_indices == nullptr)
+            == (opt_parts_audio_data_indices == nullptr));
+
+    bool const get_word_probs = opt_out_word_probs != nullptr;
+    std::vector<struct mt_stt_part_result> results;
+
+    if(!mt_stt_transcribe_results(
+            model,
+            mt_params_ref,
+            audio_data_arr,
+            audio_data_length,
+            opt_parts_audio_data_indices,
+            opt_parts_audio_data_limits,
+            opt_parts_length,
+            get_word_probs,
+            false,
+            results))
+    {
+        return nullptr;
+    }
+
+    std::string buf;
+    size_t word_probs_count = 0;
+
+    if(opt_out_parts_ret_val_indices == nullptr) // => One single "part".
+    {
+        buf.swap(results[0].text);
+    }
+    else // => Join the results in the original order.
+    {
+        for(int i = 0; i < opt_parts_length; ++i)
+        {
+            std::string const & cur_text = results[i].text;
+
+            opt_out_parts_ret_val_indices[i] = -1;
+            if(cur_text.length() != 0)
+            {
+                opt_out_parts_ret_val_indices[i] = (int)buf.length();
+
+                buf += cur_text;
+            }
+        }
+    }
+
+    if(get_word_probs)
+    {
+        *opt_out_word_probs = nullptr;
+        *opt_out_word_probs_count = 0;
+
+        for(struct mt_stt_part_result const & result_ref : results)
+        {
+            word_probs_count += result_ref.word_probs.size();
+        }
+        if(word_probs_count != 0)
+        {
+            float * dest = (float*)malloc(
+                word_probs_count * sizeof **opt_out_word_probs);
+
+            if(dest == nullptr)
+            {
+                return nullptr; // Must not get here.
+            }
+
+            *opt_out_word_probs = dest;
+            *opt_out_word_probs_count = (int)word_probs_count;
+            for(struct mt_stt_part_result const & result_ref : results)
+            {
+                if(result_ref.word_probs.empty())
+                {
+                    continue;
+                }
+                memcpy(
+                    dest,
+                    result_ref.word_probs.data(),
+                    result_ref.word_probs.size() * sizeof *dest);
+                dest += result_ref.word_probs.size();
+            }
+        }
+    }
+
+    //mt_stt_log_printf("CONTENT OF buf BEFORE RETURN: \"%s\"\n", buf.c_str());
+
+    return mt_stt_create_copy(buf);
+}
+
+/** Load a model, transcribe once and free the model, again.
+ */
+static char* transcribe_once(
+    bool const use_gpu,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
     char const * const initial_prompt,
     char * const model_file_path,
+    void * const model_data,
+    size_t const model_data_len,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    struct mt_stt_model * const model = model_file_path == nullptr
+        ? mt_stt_model_load_from_data(use_gpu, model_data, model_data_len)
+        : mt_stt_model_load_from_file(use_gpu, model_file_path);
+
+    if(model == nullptr)
+    {
+        return nullptr;
+    }
+
+    char* const ret_val = mt_stt_transcribe_with_model(
+        model,
+        n_threads,
+        language,
+        translate_to_en,
+        initial_prompt,
+        audio_data_arr,
+        audio_data_length,
+        on_progress_func,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+
+    mt_stt_model_free(model);
+    return ret_val;
+}
+
+/**
+ * - Returns NULL on error.
+ */
+static struct mt_stt_model * load_model(
+    bool const use_gpu,
+    char const * const model_file_path,
+    void * const model_data,
+    size_t const model_data_len)
+{
+    auto const start = std::chrono::steady_clock::now();
+
+    mt_stt_open_log();
+
+    struct whisper_context * const ctx = load_ctx(
+        use_gpu, model_file_path, model_data, model_data_len);
+    char const * const cpu_variant =
+        ctx == nullptr ? nullptr : mt_stt_get_cpu_variant();
+
+    mt_stt_close_log();
+
+    if(ctx == nullptr)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_model * const ret_val = new mt_stt_model;
+
+    ret_val->ctx = ctx;
+    ret_val->cpu_variant = cpu_variant;
+    ret_val->next_prompt_id = 0;
+    ret_val->result_cache.max_bytes = 0;
+    ret_val->result_cache.bytes = 0;
+    ret_val->load_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_free(void * const ptr)
+{
+    free(ptr);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel()
+{
+    ++s_cancel_generation;
+}
+
+MT_EXPORT_STT_API struct mt_stt_cancel_token * __stdcall
+    mt_stt_cancel_token_create()
+{
+    struct mt_stt_cancel_token * const ret_val = new mt_stt_cancel_token;
+
+    ret_val->cancelled = false;
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_cancel(
+    struct mt_stt_cancel_token * const token)
+{
+    if(token == nullptr)
+    {
+        return;
+    }
+    token->cancelled = true;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_reset(
+    struct mt_stt_cancel_token * const token)
+{
+    if(token == nullptr)
+    {
+        return;
+    }
+    token->cancelled = false;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_free(
+    struct mt_stt_cancel_token * const token)
+{
+    delete token;
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_file(
+    bool const use_gpu, char const * const model_file_path)
+{
+    if(model_file_path == nullptr)
+    {
+        return nullptr;
+    }
+    return load_model(use_gpu, model_file_path, nullptr, (size_t)-1);
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_data(
+    bool const use_gpu, void * const model_data, size_t const model_data_len)
+{
+    if(model_data == nullptr || model_data_len == 0)
+    {
+        return nullptr;
+    }
+    return load_model(use_gpu, nullptr, model_data, model_data_len);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_model_free(
+    struct mt_stt_model * const model)
+{
+    if(model == nullptr)
+    {
+        return;
+    }
+
+    for(struct whisper_state * const state : model->idle_states)
+    {
+        whisper_free_state(state);
+    }
+    model->idle_states.clear();
+
+    whisper_free(model->ctx);
+    model->ctx = nullptr;
+    delete model;
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_model(
+    struct mt_stt_model * const model,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
     float const * const audio_data_arr,
     int const audio_data_length,
     void (*on_progress_func)(int progress),
@@ -548,7 +1383,120 @@ MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_file(
     int const * const opt_parts_audio_data_limits,
     int const opt_parts_length)
 {
+    struct mt_stt_params params;
+
+    mt_stt_params_init(&params);
+    params.n_threads = n_threads;
+    params.language = language;
+    params.translate_to_en = translate_to_en;
+    params.initial_prompt = initial_prompt;
+    params.on_progress_func = on_progress_func;
+
+    return mt_stt_transcribe_with_params(
+        model,
+        &params,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_params_init(
+    struct mt_stt_params * const params)
+{
+    if(params == nullptr)
+    {
+        return;
+    }
+
+    params->n_threads = 0;
+    params->language = nullptr;
+    params->translate_to_en = false;
+    params->initial_prompt = nullptr;
+    params->opt_decoding_params = nullptr;
+    params->prompt_tokens = nullptr;
+    params->prompt_n_tokens = 0;
+    params->prompt_id = -1;
+    params->on_progress_func = nullptr;
+    params->on_segment_func = nullptr;
+    params->on_segment_user_data = nullptr;
+
+    params->parts_workers = 1;
+    params->parts_context = MT_STT_PARTS_CONTEXT_FULL;
+
+    params->vad_threshold_db = 10.0f;
+    params->vad_min_energy_db = -50.0f;
+    params->vad_min_speech_ms = 250;
+    params->vad_min_silence_ms = 500;
+    params->vad_pad_ms = 200;
+
+    params->reduce_audio_ctx = false;
+    params->min_audio_ctx = 256;
+
+    params->opt_out_metrics = nullptr;
+
+    params->detect_language_once = false;
+    params->detect_language_ms = 10000;
+    params->opt_language_cache_key = nullptr;
+    params->opt_out_language = nullptr;
+
+    params->opt_cancel_token = nullptr;
+    params->timeout_ms = 0;
+    params->return_partial_on_abort = false;
+    params->opt_out_aborted = nullptr;
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_params(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    if(model == nullptr || params == nullptr)
+    {
+        return nullptr;
+    }
     return transcribe(
+        model,
+        *params,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_file(
+    bool const use_gpu,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    char * const model_file_path,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    return transcribe_once(
         use_gpu,
         n_threads,
         language,
@@ -556,7 +1504,7 @@ MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_file(
         initial_prompt,
         model_file_path,
         nullptr,
-        -1,
+        (size_t)-1,
         audio_data_arr,
         audio_data_length,
         on_progress_func,
@@ -586,7 +1534,7 @@ MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_data(
     int const * const opt_parts_audio_data_limits,
     int const opt_parts_length)
 {
-    return transcribe(
+    return transcribe_once(
         use_gpu,
         n_threads,
         language,
@@ -32,10 +32,445 @@ extern "C" {
 
 #endif //__cplusplus
 
+/** Opaque handle of a loaded model, to be used for any number of
+ *  transcriptions.
+ */
+struct mt_stt_model;
+
+/** How to handle the context (the text transcribed so far, given as prompt to
+ *  Whisper) between the parts of the audio data (see mt_stt_params).
+ */
+enum mt_stt_parts_context
+{
+    /** The context is carried over from each part to the next one, so the
+     *  parts are transcribed one after another (parts_workers is ignored).
+     *  This is the default and gives the best results for parts that belong
+     *  together.
+     */
+    MT_STT_PARTS_CONTEXT_FULL = 0,
+
+    /** The parts are split into one contiguous range per worker (with about
+     *  the same amount of audio data each) and the context is carried over
+     *  from each part to the next one inside of each range, only.
+     */
+    MT_STT_PARTS_CONTEXT_PER_WORKER = 1,
+
+    /** Each part is transcribed without context, so the workers can always
+     *  take the next part that is not transcribed, yet (fastest).
+     */
+    MT_STT_PARTS_CONTEXT_NONE = 2
+};
+
+/** Sample formats of PCM audio data (see mt_stt_transcribe_pcm()).
+ */
+enum mt_stt_sample_format
+{
+    MT_STT_SAMPLE_FORMAT_F32 = 0, // Normalized to [-1.0, 1.0].
+    MT_STT_SAMPLE_FORMAT_S16 = 1,
+    MT_STT_SAMPLE_FORMAT_S32 = 2
+};
+
+/** Types to quantize a model to, see mt_stt_model_quantize().
+ */
+enum mt_stt_quant_type
+{
+    MT_STT_QUANT_Q8_0 = 0, // Best quality, about half the size of f16.
+    MT_STT_QUANT_Q5_1 = 1,
+    MT_STT_QUANT_Q4_0 = 2 // Smallest and fastest, lowest quality.
+};
+
+/** A token of a structured result (see mt_stt_result).
+ *
+ * - Times are in milliseconds, relative to the beginning of the audio data.
+ */
+struct mt_stt_token
+{
+    char const * text;
+    int id;
+    float p; // Probability.
+    long long t0_ms;
+    long long t1_ms;
+};
+
+/** A word of a structured result (see mt_stt_result), which starts with a
+ *  token beginning with whitespace (or with the first token of a segment).
+ */
+struct mt_stt_word
+{
+    char const * text; // Without the leading whitespace.
+    long long t0_ms;
+    long long t1_ms;
+    float p_first; // Probability of the word's first token.
+    float p_min; // Min. probability of the word's tokens.
+    float p_mean; // Mean probability of the word's tokens.
+    int token_index; // Of the word's first token in mt_stt_result.tokens.
+    int token_count;
+};
+
+/** A segment of a structured result (see mt_stt_result).
+ */
+struct mt_stt_segment
+{
+    char const * text;
+    long long t0_ms;
+    long long t1_ms;
+    int part_index; // Of the part the segment belongs to (0 without parts).
+    bool degraded; // The guard triggered for the part (and cut its text).
+    int word_index; // Of the segment's first word in mt_stt_result.words.
+    int word_count;
+    int token_index; // Of the segment's first token in mt_stt_result.tokens.
+    int token_count;
+};
+
+/** A structured result (see mt_stt_transcribe_result()).
+ *
+ * - Everything is held by the same allocation as the structure itself.
+ * - The arrays are NULL, if their counts are zero.
+ */
+struct mt_stt_result
+{
+    char const * text; // The whole text.
+    int segment_count;
+    struct mt_stt_segment * segments;
+    int word_count;
+    struct mt_stt_word * words;
+    int token_count;
+    struct mt_stt_token * tokens;
+};
+
+/** Levels of log messages (see mt_stt_log_configure()).
+ */
+enum mt_stt_log_level
+{
+    MT_STT_LOG_LEVEL_OFF = 0, // Logs nothing at all.
+    MT_STT_LOG_LEVEL_ERROR = 1,
+    MT_STT_LOG_LEVEL_WARN = 2,
+    MT_STT_LOG_LEVEL_INFO = 3, // Default.
+    MT_STT_LOG_LEVEL_DEBUG = 4
+};
+
+/** Metrics of one part of a transcription (see mt_stt_metrics).
+ *
+ * - All times are wall-clock times in milliseconds.
+ */
+struct mt_stt_part_metrics
+{
+    double audio_ms; // Length of the audio data.
+    double total_ms;
+
+    // Until the encoder starts (mel spectrogram and language detection, if
+    // no language is given):
+    //
+    double mel_ms;
+
+    // Encoder, including the first (batched) pass of the decoder over the
+    // prompt, because Whisper does not tell, when the encoder is done:
+    //
+    double encode_ms;
+
+    double decode_ms; // Including sampling.
+
+    int encoder_runs; // Count of (up to) 30 seconds windows encoded.
+    int tokens; // Count of tokens sampled (of all decoders and fallbacks).
+    int fallbacks; // Count of decodings repeated with a higher temperature.
+    int cache_hits; // 1, if the result was taken from the result cache.
+    int degraded; // 1, if the guard triggered (see mt_stt_decoding_params).
+};
+
+/** Metrics of a transcription, to be retrieved via mt_stt_params.
+ *
+ * - The times and counts of the parts are summed up (parts may be transcribed
+ *   at the same time, so their sums may exceed total_ms).
+ */
+struct mt_stt_metrics
+{
+    double load_ms; // Time it took to load the model used.
+
+    // Variant of ggml's CPU backend in use, e.g. "haswell" for AVX2 or
+    // "sse42" (see "make dist" in the Makefile). Static, do not free:
+    //
+    char const * cpu_variant;
+
+    double total_ms;
+    double audio_ms;
+    double rtf; // Real-time factor (total_ms / audio_ms).
+    double mel_ms;
+    double encode_ms;
+    double decode_ms;
+    int encoder_runs;
+    int tokens;
+    int fallbacks;
+    int cache_hits; // Count of parts taken from the result cache.
+    int degraded_parts; // Count of parts the guard triggered for.
+
+    // Peak resident memory of the process so far (Whisper does not tell the
+    // sizes of its scratch buffers, which are included):
+    //
+    long long peak_memory_bytes;
+
+    // Resident memory of the process at the end of the transcription and the
+    // part of it that is shared with other processes, e.g. pages of model
+    // files mapped via mt_stt_model_map() (Linux only, otherwise 0):
+    //
+    long long resident_memory_bytes;
+    long long shared_memory_bytes;
+
+    // Metrics of each part, if parts were given (in the original order),
+    // otherwise NULL. Caller takes ownership (free via mt_stt_free()):
+    //
+    int parts_count;
+    struct mt_stt_part_metrics * parts;
+};
+
+/** Version of mt_stt_decoding_params (fields are appended with each new
+ *  version, only).
+ */
+#define MT_STT_DECODING_PARAMS_VERSION 2
+
+enum mt_stt_sampling
+{
+    MT_STT_SAMPLING_GREEDY = 0,
+    MT_STT_SAMPLING_BEAM_SEARCH = 1
+};
+
+/** Presets of decoding parameters, see mt_stt_decoding_params_init().
+ */
+enum mt_stt_preset
+{
+    // Defaults of Whisper (as used, if no decoding parameters are given):
+    //
+    MT_STT_PRESET_DEFAULT = 0,
+
+    // Greedy with one single decoder, no temperature fallbacks and the guard
+    // against runaway decoding, to bound the worst-case decoding time:
+    //
+    MT_STT_PRESET_FASTEST = 1,
+
+    // Greedy with two candidates per fallback, max. two fallbacks and the
+    // guard against runaway decoding:
+    //
+    MT_STT_PRESET_BALANCED = 2,
+
+    // Beam search (five beams), with the default fallbacks:
+    //
+    MT_STT_PRESET_ACCURATE = 3
+};
+
+/** Parameters of the decoding, to be initialized via
+ *  mt_stt_decoding_params_init() (see Whisper's whisper_full_params for
+ *  details).
+ *
+ * - size and version are set by mt_stt_decoding_params_init() and tell the
+ *   library, which fields are known by the caller (fields added by later
+ *   versions get their defaults).
+ */
+struct mt_stt_decoding_params
+{
+    size_t size;
+    int version;
+
+    enum mt_stt_sampling strategy;
+    int best_of; // Candidates per temperature fallback (greedy).
+    int beam_size; // Beam search.
+    float patience; // Beam search, -1 for default.
+
+    float temperature; // Initial temperature.
+    float temperature_inc; // Increment per fallback, 0 for no fallbacks.
+
+    // Thresholds that cause a fallback (or treat a window as silence):
+    //
+    float entropy_thold;
+    float logprob_thold;
+    float no_speech_thold;
+
+    bool single_segment; // One segment per window (ignored by streams).
+    bool no_timestamps; // Don't sample timestamps (ignored by streams).
+    int max_tokens; // Max. tokens per segment, 0 for no limit.
+
+    // Version 2:
+
+    // Guard against runaway decoding (e.g. of noise or music looping on the
+    // same phrase): If triggered, the segment is ended right away and the part
+    // is marked as degraded (see mt_stt_part_metrics and mt_stt_segment).
+    // Each check is disabled, if 0. Whisper samples at most 220 tokens per
+    // window, so the tokens per second check is skipped for windows whose
+    // allowed token count reaches that limit (e.g. for windows of 14.7 seconds
+    // or longer at 15 tokens per second):
+    //
+    int guard_ngram_max; // Longest n-gram (in tokens) checked for repeats.
+    int guard_ngram_repeats; // Repeats in a row (of at least 8 tokens).
+    float guard_max_tokens_per_s; // Per second of a window's audio data.
+    float guard_max_compression_ratio; // Estimated on the window's tokens.
+    bool guard_abort_part; // Also stop transcribing the part, if triggered.
+};
+
+/** Opaque handle of a cancellation token, see mt_stt_cancel_token_create().
+ */
+struct mt_stt_cancel_token;
+
+/** A language detected by Whisper (see mt_stt_params.detect_language_once).
+ */
+struct mt_stt_language
+{
+    char const * code; // E.g. "en", NULL, if not detected (do not free).
+    float p; // Probability of the language.
+};
+
+/** A segment given to mt_stt_params.on_segment_func as soon as Whisper
+ *  finalized it.
+ *
+ * - Times are in milliseconds, relative to the beginning of the audio data.
+ * - Valid during the call of the callback, only.
+ */
+struct mt_stt_new_segment
+{
+    char const * text;
+    long long t0_ms;
+    long long t1_ms;
+    int part_index; // Of the part the segment belongs to (0 without parts).
+    float const * word_probs; // Of the segment's words, NULL, if none.
+    int word_probs_count;
+};
+
+/** Parameters of a transcription, to be initialized via mt_stt_params_init().
+ */
+struct mt_stt_params
+{
+    int n_threads; // Per worker. Set based on hardware, if <= 0.
+    char const * language; // NULL for automatic detection.
+    bool translate_to_en;
+    char const * initial_prompt; // Optional.
+
+    // Optional, defaults of Whisper are used, if NULL (must stay valid during
+    // the call):
+    //
+    struct mt_stt_decoding_params const * opt_decoding_params;
+
+    // Alternatives to initial_prompt, to avoid tokenizing the prompt for each
+    // transcription (used instead of initial_prompt, if given, the tokens
+    // must stay valid during the call):
+    //
+    int const * prompt_tokens; // Optional, see mt_stt_prompt_register_tokens().
+    int prompt_n_tokens;
+    int prompt_id; // Optional (-1), see mt_stt_prompt_register().
+
+    void (*on_progress_func)(int progress); // Optional.
+
+    // Optional, called with each new segment while the transcription is
+    // running (one call at a time, by any thread, in order per part, but the
+    // parts may interleave, if parts_workers > 1). The result cache is not
+    // used, if given (not supported by streaming sessions):
+    //
+    void (*on_segment_func)(
+        struct mt_stt_new_segment const * segment, void * user_data);
+    void * on_segment_user_data;
+
+    // Used, if parts of the audio data are given, only:
+    //
+    int parts_workers; // Count of parts to transcribe at the same time.
+    enum mt_stt_parts_context parts_context;
+
+    // Voice activity detection (see mt_stt_detect_speech()):
+    //
+    float vad_threshold_db; // Min. energy of speech above the noise floor.
+    float vad_min_energy_db; // Min. energy of speech in dBFS.
+    int vad_min_speech_ms; // Shorter speech is ignored.
+    int vad_min_silence_ms; // Speech with shorter silence between is merged.
+    int vad_pad_ms; // Added before and after each part of speech.
+
+    // Encode audio data shorter than 30 seconds with a reduced encoder
+    // context (faster, but may reduce accuracy, see README.md):
+    //
+    bool reduce_audio_ctx;
+    int min_audio_ctx; // Min. encoder context in 20 ms units (max. 1500).
+
+    // Optional, filled after each successful transcription with these
+    // parameters (not supported by streaming sessions):
+    //
+    struct mt_stt_metrics * opt_out_metrics;
+
+    // If language is NULL (or "auto"): Detect the language once from the
+    // first detect_language_ms of speech and use it for all parts (instead of
+    // letting Whisper detect the language for each part):
+    //
+    bool detect_language_once;
+    int detect_language_ms;
+    //
+    // Optional, the language detected is cached per model for this ID (e.g.
+    // of a speaker or stream) and used by following transcriptions with the
+    // same ID without detecting it, again (see mt_stt_language_cache_clear()):
+    //
+    char const * opt_language_cache_key;
+    //
+    // Optional, filled with the language detected (or cached) by each
+    // successful transcription with these parameters (not supported by
+    // streaming sessions):
+    //
+    struct mt_stt_language * opt_out_language;
+
+    // Abort the transcription, if the given token gets cancelled (see
+    // mt_stt_cancel_token_cancel()) or after timeout_ms (wall-clock time
+    // since the start of the call, per step for streaming sessions), if > 0:
+    //
+    struct mt_stt_cancel_token * opt_cancel_token; // Optional.
+    int timeout_ms;
+    //
+    // Return the text transcribed until the transcription was aborted
+    // (instead of NULL), if true (not supported by streaming sessions):
+    //
+    bool return_partial_on_abort;
+    //
+    // Optional, set to true, if the transcription was aborted (by the token,
+    // the timeout or mt_stt_cancel()), false otherwise:
+    //
+    bool * opt_out_aborted;
+};
+
+/** Opaque handle of a streaming session, see mt_stt_stream_create().
+ */
+struct mt_stt_stream;
+
+/** Opaque handle of a batcher, see mt_stt_batcher_create().
+ */
+struct mt_stt_batcher;
+
 MT_EXPORT_STT_API void __stdcall mt_stt_free(void * const ptr);
 
+/**
+ * - Cancels all transcriptions running at the time of the call (transcriptions
+ *   started later are not affected).
+ */
 MT_EXPORT_STT_API void __stdcall mt_stt_cancel();
 
+/**
+ * - Creates a token to cancel the transcriptions it is given to (via
+ *   mt_stt_params.opt_cancel_token), only.
+ * - The token may be given to any number of transcriptions, also running at
+ *   the same time, and must not be freed before they are done.
+ * - Caller takes ownership of the returned token, which needs to be freed via
+ *   mt_stt_cancel_token_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_cancel_token * __stdcall
+    mt_stt_cancel_token_create();
+
+/**
+ * - Cancels all transcriptions running with the given token and all
+ *   transcriptions started with it later, until it is reset.
+ * - May be called from any thread.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_cancel(
+    struct mt_stt_cancel_token * const token);
+
+/**
+ * - Makes the given (cancelled) token usable for following transcriptions.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_reset(
+    struct mt_stt_cancel_token * const token);
+
+MT_EXPORT_STT_API void __stdcall mt_stt_cancel_token_free(
+    struct mt_stt_cancel_token * const token);
+
 /**
  * - Caller takes ownership of the returned, zero-terminated C-string.
  * - If opt_out_word_probs is not NULL, it will be set to a dynamically
@@ -99,6 +534,549 @@ MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_data(
     int const * const opt_parts_audio_data_limits,
     int const opt_parts_length);
 
+/**
+ * - Loads the model from the given file once, so it can be used for any number
+ *   of transcriptions via mt_stt_transcribe_with_model().
+ * - Caller takes ownership of the returned handle, which needs to be freed via
+ *   mt_stt_model_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_file(
+    bool const use_gpu, char const * const model_file_path);
+
+/**
+ * - Loads the model from the given memory once, so it can be used for any
+ *   number of transcriptions via mt_stt_transcribe_with_model().
+ * - The given model data is not needed anymore, after this function returned.
+ * - Caller takes ownership of the returned handle, which needs to be freed via
+ *   mt_stt_model_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_from_data(
+    bool const use_gpu, void * const model_data, size_t const model_data_len);
+
+/**
+ * - Quantizes the given Whisper model data (f32 or f16 model, as read from a
+ *   ggml model file) in memory to the given type, e.g. to be loaded via
+ *   mt_stt_model_load_from_data().
+ * - The given model data is not modified.
+ * - If a cache folder is given, the result is read from there, if it was
+ *   stored before for the same model data and type. Otherwise, it gets stored
+ *   there (the file name is made of a hash of the model data and the type).
+ * - n_threads: Count of threads to quantize with (<= 0 for one per CPU core).
+ * - Caller takes ownership of the returned data, which needs to be freed via
+ *   mt_stt_free(). Its length is written to out_len.
+ * - Returns NULL on error (e.g. model data is already quantized).
+ */
+MT_EXPORT_STT_API void * __stdcall mt_stt_model_quantize(
+    void const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type,
+    char const * const opt_cache_dir,
+    int const n_threads,
+    size_t * const out_len);
+
+/**
+ * - Same as mt_stt_model_load_from_data(), but quantizes the given model data
+ *   first (see mt_stt_model_quantize()).
+ */
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_quantized(
+    bool const use_gpu,
+    void const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type,
+    char const * const opt_cache_dir,
+    int const n_threads);
+
+/**
+ * - Maps the given model file into memory (read-only), to be given to
+ *   mt_stt_model_load_from_data(), mt_stt_model_quantize() or
+ *   mt_stt_transcribe_with_data() without reading it into a buffer first.
+ * - The pages come from the OS' page cache and are shared by all processes
+ *   mapping the same file.
+ * - prefault_pages: Read all pages at once (via madvise() on Linux), instead
+ *   of page by page while the model is loaded (page fault stalls).
+ * - Whisper copies the model into its own buffers while loading, so the
+ *   mapping can be freed via mt_stt_model_unmap() after loading.
+ * - The length of the mapped data is written to out_len.
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API void * __stdcall mt_stt_model_map(
+    char const * const model_file_path,
+    bool const prefault_pages,
+    size_t * const out_len);
+
+/**
+ * - Unmaps model data mapped via mt_stt_model_map().
+ * - Does nothing, if NULL is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_model_unmap(
+    void * const model_data, size_t const model_data_len);
+
+/**
+ * - Same as mt_stt_model_load_from_file(), but maps the file via
+ *   mt_stt_model_map() to load the model from (and unmaps it, afterwards).
+ */
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_mapped(
+    bool const use_gpu,
+    char const * const model_file_path,
+    bool const prefault_pages);
+
+/**
+ * - Frees a model loaded via mt_stt_model_load_from_file() or
+ *   mt_stt_model_load_from_data().
+ * - No transcription must be running with the model at that time.
+ * - Does nothing, if NULL is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_model_free(
+    struct mt_stt_model * const model);
+
+/**
+ * - Same as mt_stt_transcribe_with_file() and mt_stt_transcribe_with_data(),
+ *   but uses the given, already loaded model instead of loading (and freeing)
+ *   a model on each call.
+ * - Does NOT take ownership of the model.
+ * - May be called from multiple threads at the same time with the same model,
+ *   each transcription uses its own Whisper state (idle states are kept by the
+ *   model to be reused, until the model gets freed).
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_model(
+    struct mt_stt_model * const model,
+    int const n_threads,
+    char const * const language,
+    bool const translate_to_en,
+    char const * const initial_prompt,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    void (*on_progress_func)(int progress),
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length);
+
+/**
+ * - Initializes the given parameters with the default values (one worker
+ *   keeping the full context between parts, as mt_stt_transcribe_with_model()
+ *   does).
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_params_init(
+    struct mt_stt_params * const params);
+
+/**
+ * - Same as mt_stt_transcribe_with_model(), but with the parameters given via
+ *   the structure, which must be initialized via mt_stt_params_init() first.
+ * - If parts are given, params->parts_workers of them may be transcribed at
+ *   the same time, each worker with its own Whisper state and
+ *   params->n_threads threads. The results are still returned in the original
+ *   order. See mt_stt_parts_context for the trade-off between speed and
+ *   keeping the context between parts.
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_params(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length);
+
+/**
+ * - Creates a streaming session to transcribe audio data that is given in
+ *   chunks via mt_stt_stream_push(), while it arrives (e.g. during a call).
+ * - Every step_ms milliseconds of audio data pushed (default is 500, if <= 0),
+ *   the audio data not committed, yet (the sliding window) gets transcribed
+ *   and on_text_func gets called (if not NULL) with:
+ *   - stable_text: The text newly committed by this step (to be appended to
+ *     the text committed by earlier steps). It will not change, anymore and
+ *     its audio data will not be transcribed, again.
+ *   - tentative_text: The text transcribed from the rest of the window, which
+ *     may still change (replaces the tentative text of earlier steps).
+ * - The committed text is given as prompt (after the initial prompt, if any)
+ *   for the following steps.
+ * - The session uses its own Whisper state of the given model, the model must
+ *   not be freed before the session.
+ * - params->on_progress_func, on_segment_func and the parts parameters are
+ *   ignored.
+ * - A session must not be used by multiple threads at the same time.
+ * - Caller takes ownership of the returned handle, which needs to be freed via
+ *   mt_stt_stream_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_stream * __stdcall mt_stt_stream_create(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    int const step_ms,
+    void (*on_text_func)(
+        char const * stable_text, char const * tentative_text, void * user_data),
+    void * const user_data);
+
+/**
+ * - Adds the given audio data to the session and transcribes, if enough audio
+ *   data was added since the last step (the callback is called from inside of
+ *   this function, then).
+ * - Returns false on error.
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_stream_push(
+    struct mt_stt_stream * const stream,
+    float const * const audio_data_arr,
+    int const audio_data_length);
+
+/**
+ * - Transcribes and commits the rest of the audio data given and returns all
+ *   the text committed by the session (since its creation or the last
+ *   finalization).
+ * - Resets the session afterwards, to be used for the next utterance.
+ * - Caller takes ownership of the returned, zero-terminated C-string.
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_stream_finalize(
+    struct mt_stt_stream * const stream);
+
+/**
+ * - Frees a session created via mt_stt_stream_create().
+ * - Does nothing, if NULL is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_stream_free(
+    struct mt_stt_stream * const stream);
+
+/**
+ * - Same as mt_stt_transcribe_with_params(), but takes PCM audio data in the
+ *   given sample format, with the given count of (interleaved) channels and
+ *   with any sample rate, instead of mono, normalized float samples with a
+ *   sample rate of 16 kHz.
+ * - The audio data is converted, down-mixed to mono and resampled to 16 kHz
+ *   internally (into a buffer reused by the calling thread). No conversion is
+ *   done at all for mono, float samples with a sample rate of 16 kHz.
+ * - frame_count is the count of samples per channel.
+ * - The optional parts are given as frame indices, too.
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_pcm(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_frame_indices,
+    int const * const opt_parts_frame_limits,
+    int const opt_parts_length);
+
+/**
+ * - Same as mt_stt_stream_push(), but takes PCM audio data like
+ *   mt_stt_transcribe_pcm() does.
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_stream_push_pcm(
+    struct mt_stt_stream * const stream,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count);
+
+/**
+ * - Detects the parts of the given audio data (mono, 16 kHz) that hold speech,
+ *   based on the energy of the audio data and the vad_* parameters given.
+ * - Sets the given pointers to dynamically allocated arrays with the beginning
+ *   and (exclusive) end indices of the parts, to be freed via mt_stt_free().
+ *   They are set to NULL, if no speech was detected.
+ * - Returns the count of parts or -1 on error.
+ */
+MT_EXPORT_STT_API int __stdcall mt_stt_detect_speech(
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int * * const out_parts_audio_data_indices,
+    int * * const out_parts_audio_data_limits);
+
+/**
+ * - Detects the parts of the audio data holding speech via
+ *   mt_stt_detect_speech() and transcribes these parts, only (as
+ *   mt_stt_transcribe_with_params() does with given parts).
+ * - The detected parts (beginnings and exclusive ends) and the indices of the
+ *   first transcribed character in the return value for each part (or -1) are
+ *   returned via dynamically allocated arrays, to be freed via mt_stt_free().
+ *   out_parts_length is set to the count of parts.
+ * - If no speech is detected, an empty string is returned (without running
+ *   Whisper at all) and the arrays are set to NULL.
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_vad(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * * const out_parts_audio_data_indices,
+    int * * const out_parts_audio_data_limits,
+    int * * const out_parts_ret_val_indices,
+    int * const out_parts_length);
+
+/**
+ * - Configures the logging of mt_stt and Whisper: Messages with the given
+ *   level or a more important one are appended to the log file at the given
+ *   path (if not NULL) and given to the optional sink function.
+ * - Default is MT_STT_LOG_LEVEL_INFO, file "mt_stt_log.txt" in the working
+ *   directory and no sink.
+ * - Logging never blocks a transcription: Messages are queued and written by
+ *   a background thread (started by the first transcription, it runs until
+ *   the process exits or mt_stt_log_shutdown() is called, the log file stays
+ *   open until then or until another path is configured). If the queue is full, messages are dropped (and their
+ *   count is logged).
+ * - If the log file cannot be opened, logging to the file is skipped (a
+ *   transcription never fails because of that).
+ * - The sink function is called by the background thread (one call at a time,
+ *   with a zero-terminated text, that may be a part of a message, only),
+ *   without holding any lock of the library (it may call any function of the
+ *   library). After this function returned with another sink, the old sink
+ *   may still get the messages of a write already in progress.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_log_configure(
+    enum mt_stt_log_level const level,
+    char const * const opt_file_path,
+    void (*opt_sink_func)(
+        enum mt_stt_log_level level, char const * text, void * user_data),
+    void * const user_data);
+
+/**
+ * - Stops the background thread of the logging (see mt_stt_log_configure())
+ *   after it wrote the queued messages and closes the log file.
+ * - Windows: Must be called before unloading the library via FreeLibrary(),
+ *   because the thread can not be stopped safely while the library gets
+ *   unloaded (messages still queued at the exit of the process are lost, if
+ *   not called).
+ * - Elsewhere, this is done automatically when the process exits.
+ * - The thread is started again by the next transcription.
+ * - Returns false (and does nothing), if the library is in use (e.g. by a
+ *   running transcription or a stream that was not freed, yet).
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_log_shutdown();
+
+/**
+ * - Same as mt_stt_transcribe_with_params(), but returns a structured result
+ *   with the segments, words and tokens, their timestamps and probabilities.
+ * - Caller takes ownership of the returned result, which is ONE allocation
+ *   (holding all arrays and texts) to be freed via mt_stt_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_result * __stdcall mt_stt_transcribe_result(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length);
+
+/**
+ * - Initializes the given decoding parameters with the given preset (use
+ *   MT_STT_PRESET_DEFAULT to change single parameters, only).
+ * - Returns false, if the preset is unknown.
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init(
+    struct mt_stt_decoding_params * const params,
+    enum mt_stt_preset const preset);
+
+/**
+ * - Same as mt_stt_decoding_params_init() with the preset given by its name
+ *   ("default", "fastest", "balanced" or "accurate"), e.g. from a
+ *   configuration per tenant.
+ * - Returns false, if the name is unknown.
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init_by_name(
+    struct mt_stt_decoding_params * const params, char const * const name);
+
+/**
+ * - Enables caching the results of the given model (if max_bytes > 0) with
+ *   max. max_bytes of memory used (approx.) or disables it (if 0, default).
+ * - Results are cached per part (or for the whole audio data, if no parts are
+ *   given), keyed by a hash of the audio data and all parameters that affect
+ *   the result. If the same audio data is transcribed again with the same
+ *   parameters, the cached text (and word probabilities, etc.) is returned
+ *   without running Whisper.
+ * - Parts are not cached, if the context is kept between them (see
+ *   mt_stt_params.parts_context), because their results depend on the parts
+ *   before.
+ * - The least recently used results are dropped, if the cache is full.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_result_cache_configure(
+    struct mt_stt_model * const model, size_t const max_bytes);
+
+/**
+ * - Transcribes the given audio data (or the given parts of it, see
+ *   mt_stt_transcribe_with_file()) and translates it to English at the same
+ *   time: The mel spectrogram and the encoder's output of each 30 seconds
+ *   window are computed once and used by one decoder per task.
+ * - The language is detected once (from the first speech, see
+ *   detect_language_ms in mt_stt_params), if not given.
+ * - Decodes greedily without timestamps and without context between the
+ *   windows (params->opt_decoding_params, on_progress_func, on_segment_func,
+ *   opt_out_metrics, the parts workers and the result cache are not used).
+ * - Caller takes ownership of the texts set (free each via mt_stt_free()).
+ * - opt_out_word_probs, opt_out_translation_word_probs: Optional, set to the
+ *   word probabilities of each text (see mt_stt_transcribe_with_file(), free
+ *   each via mt_stt_free()).
+ * - Returns false on error (nothing is set, then).
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_transcribe_and_translate(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    char* * const out_text,
+    char* * const out_translation,
+    float * * const opt_out_word_probs,
+    int * const opt_out_word_probs_count,
+    float * * const opt_out_translation_word_probs,
+    int * const opt_out_translation_word_probs_count);
+
+/**
+ * - Transcribes the given short clips (e.g. voice commands of a few seconds,
+ *   each mono, 32-bit float, 16 kHz) by packing as many of them as fit into
+ *   one 30 seconds window of Whisper's encoder, each followed by guard_ms
+ *   (default is 1000, if <= 0) of silence. Each window is transcribed once and
+ *   its text is split back into the clips by the timestamps of the tokens.
+ * - Much faster for many short clips than transcribing each of them, because
+ *   the encoder always processes a whole window.
+ * - The clips of a window share the language (and the initial prompt) and
+ *   Whisper may carry context from one clip to the next.
+ * - params->on_progress_func, on_segment_func, opt_out_metrics,
+ *   opt_out_language, opt_out_aborted and the parts parameters are ignored.
+ * - out_texts must have clips_count elements, which are set to the text of
+ *   each clip. Caller takes ownership of the texts (free each via
+ *   mt_stt_free()).
+ * - opt_out_word_probs and opt_out_word_probs_counts: Optional, both must have
+ *   clips_count elements, set to the word probabilities of each clip (see
+ *   mt_stt_transcribe_with_file(), free each via mt_stt_free()).
+ * - Returns false on error (nothing is set, then).
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_transcribe_batch(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const * const clips,
+    int const * const clip_lengths,
+    int const clips_count,
+    int const guard_ms,
+    char* * const out_texts,
+    float* * const opt_out_word_probs,
+    int * const opt_out_word_probs_counts);
+
+/**
+ * - Creates a batcher, which collects the clips given via
+ *   mt_stt_batcher_transcribe() by any number of threads and transcribes them
+ *   in batches (see mt_stt_transcribe_batch()) by a background thread.
+ * - A batch is transcribed, if its window is full or the first clip waited for
+ *   max_wait_ms (transcribed at once without waiting, if <= 0), while a batch
+ *   is transcribed, the next one is collected.
+ * - The parameters are copied, but pointers (e.g. opt_decoding_params) must
+ *   stay valid until the batcher is freed (see mt_stt_transcribe_batch() for
+ *   the parameters ignored).
+ * - The model must not be freed before the batcher.
+ * - Caller takes ownership of the returned handle, which needs to be freed via
+ *   mt_stt_batcher_free().
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API struct mt_stt_batcher * __stdcall mt_stt_batcher_create(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    int const max_wait_ms,
+    int const guard_ms);
+
+/**
+ * - Adds the given clip to the next batch of the given batcher and waits until
+ *   it is transcribed.
+ * - May be called by multiple threads at the same time.
+ * - Optionally gets the word probabilities (see mt_stt_transcribe_with_file()).
+ * - Caller takes ownership of the returned text (free via mt_stt_free()).
+ * - Returns NULL on error.
+ */
+MT_EXPORT_STT_API char* __stdcall mt_stt_batcher_transcribe(
+    struct mt_stt_batcher * const batcher,
+    float const * const clip,
+    int const clip_length,
+    float* * const opt_out_word_probs,
+    int * const opt_out_word_probs_count);
+
+/**
+ * - Frees the given batcher.
+ * - No call of mt_stt_batcher_transcribe() must be running at that time.
+ * - Does nothing, if NULL is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_batcher_free(
+    struct mt_stt_batcher * const batcher);
+
+/**
+ * - Configures the compute thread pool of the library, used by all
+ *   transcriptions (of all models) started afterwards, or disables it, if
+ *   n_lanes is 0 (default).
+ * - The pool consists of n_lanes persistent threads ("lanes"), each pinned to
+ *   its own CPUs. Whisper runs on a free lane with threads_per_lane threads
+ *   (mt_stt_params.n_threads is ignored), waiting for a lane, if all are busy
+ *   (one lane per part, if parts are transcribed at the same time). So
+ *   transcriptions running at the same time do not oversubscribe the CPUs.
+ * - threads_per_lane: Splits the CPUs evenly between the lanes, if <= 0.
+ * - opt_cpus: CPUs to use, e.g. "0-7,16-23" (all CPUs of the process, if
+ *   NULL).
+ * - numa_node: Uses the CPUs of the given NUMA node, only (if >= 0).
+ * - Transcriptions running at the time of the call finish with the old pool.
+ * - Returns false on error (e.g. no CPUs left), the pool is disabled then.
+ */
+MT_EXPORT_STT_API bool __stdcall mt_stt_thread_pool_configure(
+    int const n_lanes,
+    int const threads_per_lane,
+    char const * const opt_cpus,
+    int const numa_node);
+
+/**
+ * - Tokenizes the given prompt once and registers the tokens with the given
+ *   model, to be used via mt_stt_params.prompt_id by any number of
+ *   transcriptions with this model.
+ * - Prompts given via mt_stt_params.initial_prompt are also tokenized once
+ *   per model (and cached), registering avoids even the lookup and the check
+ *   of the prompt's length per transcription.
+ * - Returns the ID of the prompt (>= 0) or -1 on error (e.g. prompt too long,
+ *   max. is half of the model's text context).
+ */
+MT_EXPORT_STT_API int __stdcall mt_stt_prompt_register(
+    struct mt_stt_model * const model, char const * const prompt);
+
+/**
+ * - Same as mt_stt_prompt_register(), but with the tokens given (text tokens
+ *   of the model's vocabulary, only).
+ */
+MT_EXPORT_STT_API int __stdcall mt_stt_prompt_register_tokens(
+    struct mt_stt_model * const model,
+    int const * const tokens,
+    int const n_tokens);
+
+/**
+ * - Unregisters the prompt with the given ID (registered prompts are freed
+ *   with the model, otherwise).
+ * - Transcriptions started with the ID afterwards fail.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_prompt_unregister(
+    struct mt_stt_model * const model, int const prompt_id);
+
+/**
+ * - Removes the language cached for the given ID (see
+ *   mt_stt_params.opt_language_cache_key) or all languages cached for the
+ *   given model, if no ID is given.
+ */
+MT_EXPORT_STT_API void __stdcall mt_stt_language_cache_clear(
+    struct mt_stt_model * const model, char const * const opt_key);
+
 #ifdef __cplusplus
 }
 #endif
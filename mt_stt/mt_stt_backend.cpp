@@ -0,0 +1,96 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Finding out, which variant of ggml's CPU backend is in use.
+//
+// - With a build via "make dist" (see Makefile), ggml's CPU backend exists as
+//   one shared library per CPU variant and Whisper loads the best one
+//   supported by the CPU at runtime.
+// - Otherwise, the CPU backend is linked statically and its variant is the one
+//   it was compiled for.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "ggml-backend.h"
+
+#include <cstring>
+#include <string>
+
+/** Return true, if the given feature is in the given list.
+ */
+static bool has_feature(
+    struct ggml_backend_feature const * const features,
+    char const * const name)
+{
+    for(struct ggml_backend_feature const * f = features;
+        f->name != nullptr;
+        ++f)
+    {
+        if(strcmp(f->name, name) == 0)
+        {
+            return strcmp(f->value, "0") != 0;
+        }
+    }
+    return false;
+}
+
+char const * mt_stt_get_cpu_variant()
+{
+    ggml_backend_reg_t const reg = ggml_backend_reg_by_name("CPU");
+
+    if(reg == nullptr)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN, "Warning: No CPU backend is loaded!\n");
+        return "none";
+    }
+
+    ggml_backend_get_features_t const get_features =
+        (ggml_backend_get_features_t)ggml_backend_reg_get_proc_address(
+            reg, "ggml_backend_get_features");
+
+    if(get_features == nullptr)
+    {
+        return "unknown";
+    }
+
+    struct ggml_backend_feature const * const features = get_features(reg);
+    std::string names;
+
+    for(struct ggml_backend_feature const * f = features;
+        f->name != nullptr;
+        ++f)
+    {
+        names += ' ';
+        names += f->name;
+    }
+
+    // Names as used by ggml's GGML_CPU_ALL_VARIANTS (x86), from best to
+    // worst (the features are the ones the loaded variant was compiled
+    // with, not the ones of the CPU):
+    //
+    char const * const ret_val =
+        has_feature(features, "AMX_INT8") ? "sapphirerapids"
+        : has_feature(features, "AVX512_VBMI")
+            && has_feature(features, "AVX512_VNNI") ? "icelake"
+        : has_feature(features, "AVX512") ? "skylakex"
+        : has_feature(features, "AVX_VNNI") ? "alderlake"
+        : has_feature(features, "AVX2") ? "haswell"
+        : has_feature(features, "AVX") ? "sandybridge"
+        : has_feature(features, "SSSE3") ? "sse42"
+        : has_feature(features, "NEON") ? "arm"
+        : "generic"; // E.g. ggml's "x64" variant (no SIMD extensions).
+
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "CPU backend variant: %s (features:%s)\n",
+        ret_val,
+        names.c_str());
+    return ret_val;
+}
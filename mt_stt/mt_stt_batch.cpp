@@ -0,0 +1,544 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Micro-batching of short clips: Multiple clips are packed into one window of
+// Whisper's encoder (30 seconds), separated by silence, the window is
+// transcribed once and its tokens are split back into the clips by their
+// timestamps.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+
+static int const s_window_samples = 16000 * 30; // One window of the encoder.
+static int const s_samples_per_timestamp = 16000 / 100; // 10 ms per unit.
+static int const s_default_guard_ms = 1000;
+
+/** The result of a clip of a batch.
+ */
+struct clip_result
+{
+    std::string text;
+    std::vector<float> word_probs;
+};
+
+/** A clip waiting to be transcribed by a batcher.
+ */
+struct batch_item
+{
+    float const * clip;
+    int clip_length;
+    std::chrono::steady_clock::time_point arrival;
+
+    struct clip_result result;
+    bool done;
+    bool ok;
+};
+
+/** A batcher (see mt_stt_batcher_create()).
+ */
+struct mt_stt_batcher
+{
+    struct mt_stt_model * model;
+    struct mt_stt_params mt_params;
+    std::string language; // Copy, mt_params.language points to it.
+    std::string initial_prompt; // Copy, mt_params.initial_prompt points to it.
+    std::string language_cache_key; // Copy, see mt_params.
+    int max_wait_ms;
+    int guard_samples;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<struct batch_item *> queue;
+    bool quit;
+    std::thread thread;
+};
+
+static int get_guard_samples(int const guard_ms)
+{
+    return (0 < guard_ms ? guard_ms : s_default_guard_ms) * 16;
+}
+
+/** Transcribe the given clips packed into one window (of the given length,
+ *  the clips are placed at the given offsets in it, each followed by
+ *  guard_samples of silence) and split the result back into the clips.
+ *
+ * - Returns false on error.
+ */
+static bool transcribe_window(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    float const * const * const clips,
+    int const * const clip_lengths,
+    std::vector<int> const & offsets_ref,
+    int const guard_samples,
+    int const window_length,
+    bool const get_word_probs,
+    std::vector<float> & window_ref,
+    struct clip_result * const out_results)
+{
+    int const n = (int)offsets_ref.size();
+    std::vector<struct mt_stt_part_result> results;
+
+    window_ref.assign((size_t)window_length, 0.0f);
+    for(int i = 0; i < n; ++i)
+    {
+        memcpy(
+            window_ref.data() + offsets_ref[i],
+            clips[i],
+            (size_t)clip_lengths[i] * sizeof *window_ref.data());
+    }
+
+    if(!mt_stt_transcribe_results(
+            model,
+            mt_params_ref,
+            window_ref.data(),
+            window_length,
+            nullptr,
+            nullptr,
+            0,
+            false,
+            true, // Tokens with timestamps are needed to split the result.
+            results))
+    {
+        return false;
+    }
+
+    struct mt_stt_part_result const & result_ref = results[0];
+    int clip = 0;
+
+    for(struct mt_stt_part_token const & token_ref : result_ref.tokens)
+    {
+        // The token belongs to the clip, if it is before the middle of the
+        // guard after the clip:
+        //
+        int64_t const t = (token_ref.t0 + token_ref.t1) / 2;
+
+        while(clip + 1 < n
+            && offsets_ref[clip] + clip_lengths[clip] + guard_samples / 2
+                <= t * s_samples_per_timestamp)
+        {
+            ++clip;
+        }
+
+        char const * const text =
+            result_ref.text.c_str() + token_ref.text_index;
+
+        // One probability per word, as for transcriptions without batching:
+        //
+        if(get_word_probs
+            && std::isspace(static_cast<unsigned char>(text[0])))
+        {
+            out_results[clip].word_probs.push_back(token_ref.p);
+        }
+        out_results[clip].text.append(text, token_ref.text_length);
+    }
+    return true;
+}
+
+/** Transcribe the given clips, packed into as few windows as possible.
+ *
+ * - Returns false on error.
+ */
+static bool transcribe_batch(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    float const * const * const clips,
+    int const * const clip_lengths,
+    int const clips_count,
+    int const guard_samples,
+    bool const get_word_probs,
+    struct clip_result * const out_results)
+{
+    std::vector<float> window;
+    std::vector<int> offsets;
+    int first = 0; // First clip of the current window.
+    int length = 0; // Of the current window.
+
+    for(int i = 0; i <= clips_count; ++i)
+    {
+        int const needed = i < clips_count
+            ? clip_lengths[i] + guard_samples : 0;
+
+        if(0 < length
+            && (i == clips_count || s_window_samples < length + needed))
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_INFO,
+                "Batch window: %d clips, %d ms.\n",
+                i - first,
+                length / 16);
+
+            if(!transcribe_window(
+                    model,
+                    mt_params_ref,
+                    clips + first,
+                    clip_lengths + first,
+                    offsets,
+                    guard_samples,
+                    length,
+                    get_word_probs,
+                    window,
+                    out_results + first))
+            {
+                return false;
+            }
+            offsets.clear();
+            first = i;
+            length = 0;
+        }
+        if(i == clips_count)
+        {
+            break;
+        }
+        offsets.push_back(length);
+        length += needed; // (a clip longer than a window gets its own)
+    }
+    return true;
+}
+
+/**
+ * - Returns false, if the given clips are invalid.
+ */
+static bool is_valid(
+    float const * const * const clips,
+    int const * const clip_lengths,
+    int const clips_count)
+{
+    if(clips == nullptr || clip_lengths == nullptr || clips_count < 0)
+    {
+        return false;
+    }
+    for(int i = 0; i < clips_count; ++i)
+    {
+        if(clips[i] == nullptr || clip_lengths[i] <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Get a copy of the given parameters without the outputs that do not
+ *  support batching.
+ */
+static struct mt_stt_params get_batch_params(
+    struct mt_stt_params const * const params)
+{
+    struct mt_stt_params ret_val = *params;
+
+    ret_val.on_progress_func = nullptr;
+    ret_val.on_segment_func = nullptr; // (segments may span multiple clips)
+    ret_val.opt_out_metrics = nullptr;
+    ret_val.opt_out_language = nullptr;
+    ret_val.opt_out_aborted = nullptr;
+    return ret_val;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_transcribe_batch(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const * const clips,
+    int const * const clip_lengths,
+    int const clips_count,
+    int const guard_ms,
+    char* * const out_texts,
+    float* * const opt_out_word_probs,
+    int * const opt_out_word_probs_counts)
+{
+    if(model == nullptr || params == nullptr || out_texts == nullptr
+        || !is_valid(clips, clip_lengths, clips_count)
+        || ((opt_out_word_probs == nullptr)
+            != (opt_out_word_probs_counts == nullptr)))
+    {
+        return false;
+    }
+
+    struct mt_stt_params const mt_params = get_batch_params(params);
+    bool const get_word_probs = opt_out_word_probs != nullptr;
+    std::vector<struct clip_result> results((size_t)clips_count);
+
+    mt_stt_open_log();
+
+    bool const ok = transcribe_batch(
+        model,
+        mt_params,
+        clips,
+        clip_lengths,
+        clips_count,
+        get_guard_samples(guard_ms),
+        get_word_probs,
+        results.data());
+
+    mt_stt_close_log();
+
+    if(!ok)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < clips_count; ++i)
+    {
+        out_texts[i] = mt_stt_create_copy(results[i].text);
+        if(!get_word_probs)
+        {
+            continue;
+        }
+
+        std::vector<float> const & probs_ref = results[i].word_probs;
+
+        opt_out_word_probs[i] = nullptr;
+        opt_out_word_probs_counts[i] = (int)probs_ref.size();
+        if(!probs_ref.empty())
+        {
+            opt_out_word_probs[i] =
+                (float *)malloc(probs_ref.size() * sizeof *probs_ref.data());
+            memcpy(
+                opt_out_word_probs[i],
+                probs_ref.data(),
+                probs_ref.size() * sizeof *probs_ref.data());
+        }
+    }
+    return true;
+}
+
+/** Take the clips waiting (as many as fit into one window), after waiting for
+ *  more clips up to the max. wait time of the first one.
+ *
+ * - Lock must be held.
+ * - Returns an empty batch, if the batcher is to quit.
+ */
+static void take_batch(
+    struct mt_stt_batcher * const batcher,
+    std::unique_lock<std::mutex> & lock_ref,
+    std::vector<struct batch_item *> & out_items)
+{
+    out_items.clear();
+
+    batcher->cv.wait(
+        lock_ref,
+        [batcher]() { return batcher->quit || !batcher->queue.empty(); });
+
+    auto const deadline = batcher->queue.empty()
+        ? std::chrono::steady_clock::now()
+        : batcher->queue.front()->arrival
+            + std::chrono::milliseconds(batcher->max_wait_ms);
+
+    while(!batcher->quit)
+    {
+        int length = 0;
+
+        for(struct batch_item const * const item : batcher->queue)
+        {
+            length += item->clip_length + batcher->guard_samples;
+        }
+        if(s_window_samples <= length
+            || deadline <= std::chrono::steady_clock::now())
+        {
+            break; // Window is full or waited long enough.
+        }
+        batcher->cv.wait_until(lock_ref, deadline);
+    }
+    if(batcher->quit)
+    {
+        return;
+    }
+
+    int length = 0;
+
+    while(!batcher->queue.empty())
+    {
+        struct batch_item * const item = batcher->queue.front();
+        int const needed = item->clip_length + batcher->guard_samples;
+
+        if(!out_items.empty() && s_window_samples < length + needed)
+        {
+            break;
+        }
+        length += needed;
+        out_items.push_back(item);
+        batcher->queue.pop_front();
+    }
+}
+
+static void run_batcher(struct mt_stt_batcher * const batcher)
+{
+    std::vector<struct batch_item *> items;
+    std::vector<float const *> clips;
+    std::vector<int> clip_lengths;
+    std::vector<struct clip_result> results;
+    std::unique_lock<std::mutex> lock(batcher->mutex);
+
+    while(true)
+    {
+        take_batch(batcher, lock, items);
+        if(items.empty())
+        {
+            return; // Quit.
+        }
+
+        clips.clear();
+        clip_lengths.clear();
+        for(struct batch_item const * const item : items)
+        {
+            clips.push_back(item->clip);
+            clip_lengths.push_back(item->clip_length);
+        }
+        results.assign(items.size(), clip_result());
+
+        lock.unlock();
+
+        mt_stt_open_log();
+
+        bool const ok = transcribe_batch(
+            batcher->model,
+            batcher->mt_params,
+            clips.data(),
+            clip_lengths.data(),
+            (int)items.size(),
+            batcher->guard_samples,
+            true,
+            results.data());
+
+        mt_stt_close_log();
+
+        lock.lock();
+
+        for(size_t i = 0; i < items.size(); ++i)
+        {
+            items[i]->result.text.swap(results[i].text);
+            items[i]->result.word_probs.swap(results[i].word_probs);
+            items[i]->ok = ok;
+            items[i]->done = true;
+        }
+        batcher->cv.notify_all();
+    }
+}
+
+MT_EXPORT_STT_API struct mt_stt_batcher * __stdcall mt_stt_batcher_create(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    int const max_wait_ms,
+    int const guard_ms)
+{
+    if(model == nullptr || params == nullptr)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_batcher * const batcher = new mt_stt_batcher;
+
+    batcher->model = model;
+    batcher->mt_params = get_batch_params(params);
+    if(params->language != nullptr)
+    {
+        batcher->language = params->language;
+        batcher->mt_params.language = batcher->language.c_str();
+    }
+    if(params->initial_prompt != nullptr)
+    {
+        batcher->initial_prompt = params->initial_prompt;
+        batcher->mt_params.initial_prompt = batcher->initial_prompt.c_str();
+    }
+    if(params->opt_language_cache_key != nullptr)
+    {
+        batcher->language_cache_key = params->opt_language_cache_key;
+        batcher->mt_params.opt_language_cache_key =
+            batcher->language_cache_key.c_str();
+    }
+    batcher->max_wait_ms = 0 < max_wait_ms ? max_wait_ms : 0;
+    batcher->guard_samples = get_guard_samples(guard_ms);
+    batcher->quit = false;
+    batcher->thread = std::thread(run_batcher, batcher);
+    return batcher;
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_batcher_transcribe(
+    struct mt_stt_batcher * const batcher,
+    float const * const clip,
+    int const clip_length,
+    float* * const opt_out_word_probs,
+    int * const opt_out_word_probs_count)
+{
+    if(batcher == nullptr || clip == nullptr || clip_length <= 0
+        || ((opt_out_word_probs == nullptr)
+            != (opt_out_word_probs_count == nullptr)))
+    {
+        return nullptr;
+    }
+
+    struct batch_item item;
+
+    item.clip = clip;
+    item.clip_length = clip_length;
+    item.arrival = std::chrono::steady_clock::now();
+    item.done = false;
+    item.ok = false;
+
+    {
+        std::unique_lock<std::mutex> lock(batcher->mutex);
+
+        batcher->queue.push_back(&item);
+        batcher->cv.notify_all();
+        batcher->cv.wait(lock, [&item]() { return item.done; });
+    }
+
+    if(!item.ok)
+    {
+        return nullptr;
+    }
+
+    if(opt_out_word_probs != nullptr)
+    {
+        std::vector<float> const & probs_ref = item.result.word_probs;
+
+        *opt_out_word_probs = nullptr;
+        *opt_out_word_probs_count = (int)probs_ref.size();
+        if(!probs_ref.empty())
+        {
+            *opt_out_word_probs =
+                (float *)malloc(probs_ref.size() * sizeof *probs_ref.data());
+            memcpy(
+                *opt_out_word_probs,
+                probs_ref.data(),
+                probs_ref.size() * sizeof *probs_ref.data());
+        }
+    }
+    return mt_stt_create_copy(item.result.text);
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_batcher_free(
+    struct mt_stt_batcher * const batcher)
+{
+    if(batcher == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> const lock(batcher->mutex);
+
+        batcher->quit = true;
+    }
+    batcher->cv.notify_all();
+    batcher->thread.join();
+    delete batcher;
+}
@@ -0,0 +1,219 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Caching the results of transcribed (parts of) audio data per model, keyed
+// by a hash of the audio data and the parameters that affect the result
+// (least recently used results are dropped, if the cache is full).
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+template<typename T> static void append(std::string & key_ref, T const val)
+{
+    key_ref.append((char const *)&val, sizeof val);
+}
+
+static void append_str(std::string & key_ref, char const * const str)
+{
+    if(str != nullptr)
+    {
+        key_ref.append(str);
+    }
+    key_ref.push_back('\0');
+}
+
+/** Get the approx. count of bytes used by the given cache entry.
+ */
+static size_t get_bytes(struct mt_stt_result_cache_entry const & entry_ref)
+{
+    struct mt_stt_part_result const & result_ref = entry_ref.result;
+
+    return sizeof entry_ref
+        + 2 * entry_ref.key.size() // Also used as key of the index.
+        + result_ref.text.size()
+        + result_ref.word_probs.size() * sizeof(float)
+        + result_ref.tokens.size() * sizeof(struct mt_stt_part_token)
+        + result_ref.segments.size() * sizeof(struct mt_stt_part_segment)
+        + 64; // List and index nodes.
+}
+
+/** Drop the least recently used entries, until the cache is small enough.
+ *
+ * - The cache must be locked by the caller.
+ */
+static void shrink(struct mt_stt_result_cache & cache_ref)
+{
+    while(cache_ref.max_bytes.load() < cache_ref.bytes
+        && !cache_ref.entries.empty())
+    {
+        struct mt_stt_result_cache_entry const & last_ref =
+            cache_ref.entries.back();
+
+        cache_ref.bytes -= last_ref.bytes;
+        cache_ref.index.erase(last_ref.key);
+        cache_ref.entries.pop_back();
+    }
+}
+
+void mt_stt_cache_get_key(
+    struct whisper_full_params const & params_ref,
+    struct mt_stt_guard const & guard_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    std::string & out_key)
+{
+    size_t const audio_bytes = (size_t)audio_data_length * sizeof(float);
+
+    out_key.clear();
+    append(out_key, mt_stt_get_hash(audio_data_arr, audio_bytes));
+    append(out_key, audio_data_length);
+
+    // Everything of the Whisper parameters that may change the result:
+
+    append(out_key, (int)params_ref.strategy);
+    append_str(out_key, params_ref.language);
+    append(out_key, params_ref.translate);
+    append(out_key, params_ref.no_timestamps);
+    append(out_key, params_ref.single_segment);
+    append(out_key, params_ref.max_len);
+    append(out_key, params_ref.split_on_word);
+    append(out_key, params_ref.max_tokens);
+    append(out_key, params_ref.audio_ctx);
+    append(out_key, params_ref.tdrz_enable);
+    append_str(out_key, params_ref.suppress_regex);
+    append(out_key, params_ref.suppress_blank);
+    append(out_key, params_ref.suppress_nst);
+    append(out_key, params_ref.temperature);
+    append(out_key, params_ref.max_initial_ts);
+    append(out_key, params_ref.temperature_inc);
+    append(out_key, params_ref.entropy_thold);
+    append(out_key, params_ref.logprob_thold);
+    append(out_key, params_ref.no_speech_thold);
+    append(out_key, params_ref.length_penalty);
+    append(out_key, params_ref.greedy.best_of);
+    append(out_key, params_ref.beam_search.beam_size);
+    append(out_key, params_ref.beam_search.patience);
+    append(out_key, params_ref.prompt_n_tokens);
+    if(0 < params_ref.prompt_n_tokens)
+    {
+        out_key.append(
+            (char const *)params_ref.prompt_tokens,
+            (size_t)params_ref.prompt_n_tokens * sizeof(whisper_token));
+    }
+
+    // The guard (of the request) may cut the result:
+
+    append(out_key, guard_ref.ngram_max);
+    append(out_key, guard_ref.ngram_repeats);
+    append(out_key, guard_ref.max_tokens_per_s);
+    append(out_key, guard_ref.max_compression_ratio);
+    append(out_key, guard_ref.abort_part);
+}
+
+bool mt_stt_cache_get(
+    struct mt_stt_result_cache & cache_ref,
+    std::string const & key_ref,
+    struct mt_stt_request const * const req,
+    struct mt_stt_part_result * const out_result)
+{
+    std::lock_guard<std::mutex> const lock(cache_ref.mutex);
+    auto const it = cache_ref.index.find(key_ref);
+
+    if(it == cache_ref.index.end())
+    {
+        return false;
+    }
+
+    struct mt_stt_result_cache_entry const & entry_ref = *it->second;
+
+    if((req->get_word_probs && !entry_ref.has_word_probs)
+        || (req->get_tokens && !entry_ref.has_tokens))
+    {
+        return false; // Must be transcribed again (and replaced).
+    }
+
+    // Most recently used:
+    //
+    cache_ref.entries.splice(
+        cache_ref.entries.begin(), cache_ref.entries, it->second);
+
+    out_result->text = entry_ref.result.text;
+    out_result->degraded = entry_ref.result.degraded;
+    out_result->word_probs.clear();
+    if(req->get_word_probs)
+    {
+        out_result->word_probs = entry_ref.result.word_probs;
+    }
+    out_result->tokens.clear();
+    out_result->segments.clear();
+    if(req->get_tokens)
+    {
+        out_result->tokens = entry_ref.result.tokens;
+        out_result->segments = entry_ref.result.segments;
+    }
+    return true;
+}
+
+void mt_stt_cache_put(
+    struct mt_stt_result_cache & cache_ref,
+    std::string const & key_ref,
+    struct mt_stt_request const * const req,
+    struct mt_stt_part_result const & result_ref)
+{
+    std::lock_guard<std::mutex> const lock(cache_ref.mutex);
+
+    if(cache_ref.max_bytes.load() == 0)
+    {
+        return; // Disabled (since the lookup).
+    }
+
+    auto const it = cache_ref.index.find(key_ref);
+
+    if(it != cache_ref.index.end()) // => Replace (e.g. without word probs.).
+    {
+        cache_ref.bytes -= it->second->bytes;
+        cache_ref.entries.erase(it->second);
+        cache_ref.index.erase(it);
+    }
+
+    cache_ref.entries.emplace_front();
+
+    struct mt_stt_result_cache_entry & entry_ref = cache_ref.entries.front();
+
+    entry_ref.key = key_ref;
+    entry_ref.result = result_ref;
+    entry_ref.has_word_probs = req->get_word_probs;
+    entry_ref.has_tokens = req->get_tokens;
+    entry_ref.bytes = get_bytes(entry_ref);
+
+    cache_ref.bytes += entry_ref.bytes;
+    cache_ref.index.emplace(key_ref, cache_ref.entries.begin());
+
+    shrink(cache_ref); // May also drop the new entry, if too big.
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_result_cache_configure(
+    struct mt_stt_model * const model, size_t const max_bytes)
+{
+    if(model == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> const lock(model->result_cache.mutex);
+
+    model->result_cache.max_bytes = max_bytes;
+    shrink(model->result_cache);
+}
@@ -0,0 +1,236 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Decoding parameters (see mt_stt_decoding_params) and their presets.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+/** Min. size of decoding parameters given by a caller (the size and version
+ *  fields must be there).
+ */
+static size_t const s_min_size =
+    offsetof(struct mt_stt_decoding_params, version)
+        + sizeof(((struct mt_stt_decoding_params *)nullptr)->version);
+
+/** Set the defaults of Whisper (as used, if no decoding parameters are
+ *  given).
+ */
+static void init_default(struct mt_stt_decoding_params * const params)
+{
+    struct whisper_full_params const w = whisper_full_default_params(
+        WHISPER_SAMPLING_GREEDY);
+
+    memset(params, 0, sizeof *params);
+
+    params->size = sizeof *params;
+    params->version = MT_STT_DECODING_PARAMS_VERSION;
+
+    params->strategy = MT_STT_SAMPLING_GREEDY;
+    params->best_of = w.greedy.best_of;
+    params->beam_size = w.beam_search.beam_size;
+    params->patience = w.beam_search.patience;
+    params->temperature = w.temperature;
+    params->temperature_inc = w.temperature_inc;
+    params->entropy_thold = w.entropy_thold;
+    params->logprob_thold = w.logprob_thold;
+    params->no_speech_thold = w.no_speech_thold;
+    params->single_segment = w.single_segment;
+    params->no_timestamps = w.no_timestamps;
+    params->max_tokens = w.max_tokens;
+}
+
+/** Enable the guard against runaway decoding (disabled by default, as
+ *  Whisper does not have it).
+ */
+static void set_guard(struct mt_stt_decoding_params * const params)
+{
+    params->guard_ngram_max = 8;
+    params->guard_ngram_repeats = 4;
+    params->guard_max_tokens_per_s = 15.0f; // Fast speech has about 6.
+    params->guard_max_compression_ratio = 2.4f;
+    params->guard_abort_part = false;
+}
+
+bool mt_stt_get_decoding_params(
+    struct mt_stt_decoding_params const * const opt_params,
+    struct mt_stt_decoding_params & out_params)
+{
+    init_default(&out_params);
+    if(opt_params == nullptr)
+    {
+        return true;
+    }
+
+    if(opt_params->size < s_min_size || opt_params->version < 1)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Invalid decoding parameters (size %d, version %d)!\n",
+            (int)opt_params->size,
+            opt_params->version);
+        return false;
+    }
+
+    // Fields unknown to the caller (added by later versions) keep their
+    // defaults:
+    //
+    memcpy(
+        &out_params,
+        opt_params,
+        std::min(opt_params->size, sizeof out_params));
+    out_params.size = sizeof out_params;
+    out_params.version = MT_STT_DECODING_PARAMS_VERSION;
+
+    if(out_params.strategy != MT_STT_SAMPLING_GREEDY
+        && out_params.strategy != MT_STT_SAMPLING_BEAM_SEARCH)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Invalid sampling strategy %d!\n",
+            (int)out_params.strategy);
+        return false;
+    }
+    return true;
+}
+
+void mt_stt_apply_decoding_params(
+    struct mt_stt_decoding_params const & params_ref,
+    struct whisper_full_params & out_params)
+{
+    out_params.strategy = params_ref.strategy == MT_STT_SAMPLING_BEAM_SEARCH
+        ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY;
+    out_params.greedy.best_of = std::max(1, params_ref.best_of);
+    out_params.beam_search.beam_size = std::max(1, params_ref.beam_size);
+    out_params.beam_search.patience = params_ref.patience;
+    out_params.temperature = params_ref.temperature;
+    out_params.temperature_inc = params_ref.temperature_inc;
+    out_params.entropy_thold = params_ref.entropy_thold;
+    out_params.logprob_thold = params_ref.logprob_thold;
+    out_params.no_speech_thold = params_ref.no_speech_thold;
+    out_params.single_segment = params_ref.single_segment;
+    out_params.no_timestamps = params_ref.no_timestamps;
+    out_params.max_tokens = std::max(0, params_ref.max_tokens);
+
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "strategy = %d; best_of = %d; beam_size = %d; temperature = %.2f;"
+            " temperature_inc = %.2f; max_tokens = %d\n",
+        (int)params_ref.strategy,
+        out_params.greedy.best_of,
+        out_params.beam_search.beam_size,
+        out_params.temperature,
+        out_params.temperature_inc,
+        out_params.max_tokens);
+}
+
+void mt_stt_get_guard(
+    struct mt_stt_decoding_params const * const opt_params,
+    struct mt_stt_guard & out_guard)
+{
+    struct mt_stt_decoding_params params;
+
+    memset(&out_guard, 0, sizeof out_guard);
+    if(!mt_stt_get_decoding_params(opt_params, params))
+    {
+        return; // (transcription fails, see mt_stt_init_full_params())
+    }
+    out_guard.ngram_max = std::max(0, params.guard_ngram_max);
+    out_guard.ngram_repeats = std::max(0, params.guard_ngram_repeats);
+    out_guard.max_tokens_per_s = std::max(0.0f, params.guard_max_tokens_per_s);
+    out_guard.max_compression_ratio =
+        std::max(0.0f, params.guard_max_compression_ratio);
+    out_guard.abort_part = params.guard_abort_part;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init(
+    struct mt_stt_decoding_params * const params,
+    enum mt_stt_preset const preset)
+{
+    if(params == nullptr)
+    {
+        return false;
+    }
+
+    init_default(params);
+
+    switch(preset)
+    {
+        case MT_STT_PRESET_DEFAULT:
+            return true;
+
+        case MT_STT_PRESET_FASTEST:
+        {
+            // One single decoder and no fallbacks (at most one decoder run
+            // per window):
+            //
+            params->best_of = 1;
+            params->temperature_inc = 0.0f;
+            set_guard(params);
+            return true;
+        }
+
+        case MT_STT_PRESET_BALANCED:
+        {
+            // Fewer candidates and at most two fallbacks (at temperatures 0.4
+            // and 0.8) instead of five:
+            //
+            params->best_of = 2;
+            params->temperature_inc = 0.4f;
+            set_guard(params);
+            return true;
+        }
+
+        case MT_STT_PRESET_ACCURATE:
+        {
+            params->strategy = MT_STT_SAMPLING_BEAM_SEARCH;
+            params->beam_size = 5;
+            params->best_of = 5; // For the fallbacks.
+            return true;
+        }
+
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_decoding_params_init_by_name(
+    struct mt_stt_decoding_params * const params, char const * const name)
+{
+    static struct
+    {
+        char const * name;
+        enum mt_stt_preset preset;
+    } const presets[] = {
+        { "default", MT_STT_PRESET_DEFAULT },
+        { "fastest", MT_STT_PRESET_FASTEST },
+        { "balanced", MT_STT_PRESET_BALANCED },
+        { "accurate", MT_STT_PRESET_ACCURATE }
+    };
+
+    if(name == nullptr)
+    {
+        return false;
+    }
+    for(auto const & p : presets)
+    {
+        if(strcmp(name, p.name) == 0)
+        {
+            return mt_stt_decoding_params_init(params, p.preset);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,246 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Guard against runaway decoding (see mt_stt_decoding_params), e.g. of noise
+// or music, where Whisper's decoder may loop on the same phrase until the max.
+// count of tokens of a window is reached (and do that again for each
+// temperature fallback).
+//
+// - Checked before each token gets sampled (via Whisper's logits filter), on
+//   the text tokens sampled so far by the decoder for the current window.
+// - If triggered, all logits but the one of the end of text are suppressed,
+//   which ends the segment (and the rest of the window) right away.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+
+// Min. count of tokens repeated in a row, before n-gram repeats trigger (e.g.
+// a short word said four times may be fine):
+//
+static int const s_min_repeated_tokens = 8;
+
+// Min. count of tokens to estimate the compression ratio of:
+//
+static int const s_min_compression_tokens = 32;
+
+/** Returns true, if the given tokens end with an n-gram (for any n up to the
+ *  given max.) repeated the given count of times in a row.
+ */
+static bool has_repeats(
+    std::vector<whisper_token> const & ids_ref,
+    int const ngram_max,
+    int const repeats)
+{
+    int const n_ids = (int)ids_ref.size();
+
+    for(int n = 1; n <= ngram_max; ++n)
+    {
+        int const r = std::max(
+            std::max(2, repeats), (s_min_repeated_tokens + n - 1) / n);
+        int i = n_ids - n * r;
+
+        if(i < 0)
+        {
+            continue;
+        }
+
+        // Each token must equal the one n tokens later:
+        //
+        while(i + n < n_ids && ids_ref[i] == ids_ref[i + n])
+        {
+            ++i;
+        }
+        if(i + n == n_ids)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Estimate the compression ratio of the given tokens (OpenAI's Whisper uses
+ *  the one of gzip on the text): Greedy LZ77 parsing, where each literal
+ *  token and each match (of at least 3 tokens) cost 1, because gzip needs
+ *  about as many bits for a back-reference as for the text of one token.
+ */
+static float get_compression_ratio(std::vector<whisper_token> const & ids_ref)
+{
+    static int const min_match = 3;
+
+    // Last position of each 3-gram (reused per thread):
+    //
+    static thread_local std::unordered_map<uint64_t, int> last;
+
+    int const n_ids = (int)ids_ref.size();
+    auto const get_key = [&ids_ref](int const pos)
+        {
+            return ((uint64_t)(uint32_t)ids_ref[pos] << 42)
+                ^ ((uint64_t)(uint32_t)ids_ref[pos + 1] << 21)
+                ^ (uint64_t)(uint32_t)ids_ref[pos + 2];
+        };
+    int cost = 0;
+    int i = 0;
+
+    last.clear();
+    while(i < n_ids)
+    {
+        int len = 0;
+
+        if(i + min_match <= n_ids)
+        {
+            uint64_t const key = get_key(i);
+            auto const it = last.find(key);
+
+            if(it != last.end()) // => At least min_match tokens match.
+            {
+                int const j = it->second;
+
+                while(i + len < n_ids && ids_ref[j + len] == ids_ref[i + len])
+                {
+                    ++len;
+                }
+            }
+            last[key] = i;
+        }
+
+        if(len < min_match)
+        {
+            ++cost;
+            ++i;
+            continue;
+        }
+
+        ++cost;
+        for(int k = i + 1; k < i + len && k + min_match <= n_ids; ++k)
+        {
+            last[get_key(k)] = k;
+        }
+        i += len;
+    }
+    return cost == 0 ? 1.0f : (float)n_ids / (float)cost;
+}
+
+void mt_stt_guard_begin_window(
+    struct whisper_state * const state, struct mt_stt_part * const part)
+{
+    // Whisper's seek is not available, but it continues after the end of the
+    // last segment (in 10 ms units), if there is one. Windows without any
+    // segment (e.g. silence) are not accounted for, which just makes the
+    // guard less strict:
+    //
+    // * Hard-coded for a sample rate of 16000 Hz!
+    //
+    int const n_segments = whisper_full_n_segments_from_state(state);
+    int64_t const seek = n_segments == 0
+        ? 0
+        : whisper_full_get_segment_t1_from_state(state, n_segments - 1) * 160;
+
+    part->window_audio_length = (int)std::max(
+        (int64_t)0, (int64_t)part->audio_data_length - seek);
+}
+
+void mt_stt_guard_check(
+    struct whisper_context * const ctx,
+    struct mt_stt_part * const part,
+    whisper_token_data const * const tokens,
+    int const n_tokens,
+    float * const logits)
+{
+    struct mt_stt_guard const & guard_ref = part->req->guard;
+
+    if(guard_ref.ngram_max <= 0
+        && guard_ref.max_tokens_per_s <= 0.0f
+        && guard_ref.max_compression_ratio <= 0.0f)
+    {
+        return; // Disabled.
+    }
+
+    static thread_local std::vector<whisper_token> ids; // Reused per thread.
+
+    whisper_token const tok_eot = whisper_token_eot(ctx);
+
+    ids.clear();
+    for(int i = 0; i < n_tokens; ++i)
+    {
+        if(tokens[i].id < tok_eot) // => Text token.
+        {
+            ids.push_back(tokens[i].id);
+        }
+    }
+    if(ids.empty())
+    {
+        return;
+    }
+
+    // A window holds up to 30 seconds of the part's audio data left (and at
+    // least one second, because of the padding):
+    //
+    double const window_s = std::min(
+        30.0, std::max(1.0, (double)part->window_audio_length / 16000.0));
+    double const max_tokens = (double)guard_ref.max_tokens_per_s * window_s;
+
+    // Whisper samples at most this count of tokens per window, long windows
+    // are left to the other checks:
+    //
+    double const max_window_tokens = (double)(whisper_n_text_ctx(ctx) / 2 - 4);
+    char const * reason = nullptr;
+
+    if(0 < guard_ref.ngram_max && 0 < guard_ref.ngram_repeats
+        && has_repeats(ids, guard_ref.ngram_max, guard_ref.ngram_repeats))
+    {
+        reason = "repeated n-gram";
+    }
+    else if(0.0f < guard_ref.max_tokens_per_s
+        && max_tokens < max_window_tokens
+        && max_tokens < (double)ids.size())
+    {
+        reason = "tokens per second";
+    }
+    else if(0.0f < guard_ref.max_compression_ratio
+        && s_min_compression_tokens <= (int)ids.size()
+        && guard_ref.max_compression_ratio < get_compression_ratio(ids))
+    {
+        reason = "compression ratio";
+    }
+    if(reason == nullptr)
+    {
+        return;
+    }
+
+    if(!part->degraded.exchange(true))
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN,
+            "Warning: Guard triggered for part %d (%s after %d tokens)!\n",
+            part->index,
+            reason,
+            (int)ids.size());
+    }
+
+    // Force the end of the segment:
+    //
+    int const n_vocab = whisper_n_vocab(ctx);
+
+    for(whisper_token id = 0; id < n_vocab; ++id)
+    {
+        if(id != tok_eot)
+        {
+            logits[id] = -INFINITY;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Hash shared by the library and mt_stt_daemon (which does not include
+// mt_stt_internal.h), so both use the same keys (e.g. of model data).
+
+#ifndef MT_STT_HASH
+#define MT_STT_HASH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/** Get a (fast, non-cryptographic) 64-bit hash of the given bytes.
+ */
+static inline uint64_t mt_stt_get_hash(
+    void const * const data, size_t const len)
+{
+    static uint64_t const prime = 0x9E3779B97F4A7C15ULL;
+
+    unsigned char const * const bytes = (unsigned char const *)data;
+    uint64_t ret_val = 0xCBF29CE484222325ULL ^ (len * prime);
+    size_t i = 0;
+
+    for(; i + 8 <= len; i += 8)
+    {
+        uint64_t w;
+
+        memcpy(&w, bytes + i, 8);
+        ret_val = (ret_val ^ w) * prime;
+        ret_val ^= ret_val >> 29;
+    }
+    for(; i < len; ++i)
+    {
+        ret_val = (ret_val ^ bytes[i]) * prime;
+    }
+    ret_val ^= ret_val >> 32;
+    return ret_val;
+}
+
+#endif //MT_STT_HASH
@@ -0,0 +1,494 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Declarations shared by the source files of the library, only (NOT part of
+// the interface, see mt_stt.h for that).
+
+#ifndef MT_STT_INTERNAL
+#define MT_STT_INTERNAL
+
+#include "mt_stt.h"
+#include "mt_stt_hash.h"
+#include "whisper.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** See mt_stt_cancel_token_create().
+ */
+struct mt_stt_cancel_token
+{
+    std::atomic<bool> cancelled;
+};
+
+struct mt_stt_result_cache;
+
+/** Settings of the guard against runaway decoding of a request (see
+ *  mt_stt_decoding_params and mt_stt_guard.cpp), each check is disabled, if
+ *  0.
+ */
+struct mt_stt_guard
+{
+    int ngram_max;
+    int ngram_repeats;
+    float max_tokens_per_s;
+    float max_compression_ratio;
+    bool abort_part;
+};
+
+/** The state of a single transcription.
+ */
+struct mt_stt_request
+{
+    void (*on_progress_func)(int progress);
+    void (*on_segment_func)(
+        struct mt_stt_new_segment const * segment, void * user_data);
+    void * on_segment_user_data;
+    std::mutex segment_mutex; // To call on_segment_func once at a time.
+    unsigned int cancel_generation;
+    struct mt_stt_cancel_token const * cancel_token; // Optional.
+    bool has_deadline;
+    std::chrono::steady_clock::time_point deadline;
+    bool return_partial; // Results so far are used, if aborted.
+
+    // Results of parts are taken from and put into this cache, if not NULL
+    // (see mt_stt_cache.cpp):
+    //
+    struct mt_stt_result_cache * result_cache;
+    int parts_count;
+    int min_audio_ctx; // Reduce encoder context down to this, if > 0.
+    bool get_word_probs;
+    bool get_tokens; // Get tokens and segments (see mt_stt_part_result).
+    struct mt_stt_guard guard;
+
+    // Progress of each part in percent, may be updated by multiple workers:
+    //
+    std::mutex progress_mutex;
+    std::vector<int> parts_progress;
+
+    std::atomic<bool> failed; // Set, if a part's transcription failed.
+    std::atomic<bool> aborted; // Set, if cancelled or deadline passed.
+
+    // Metrics of each part, each written by the worker transcribing the part:
+    //
+    std::vector<struct mt_stt_part_metrics> parts_metrics;
+};
+
+/** A part of a transcription, given to Whisper's callbacks via their user
+ *  data pointers.
+ */
+struct mt_stt_part
+{
+    struct mt_stt_request * req;
+    int index;
+
+    // Of the part's (not padded) audio data in the whole audio data, to get
+    // the times of new segments:
+    //
+    int audio_data_index;
+    int audio_data_length;
+
+    // Set, if the guard triggered (see mt_stt_guard.cpp), maybe by another
+    // thread of Whisper:
+    //
+    std::atomic<bool> degraded;
+
+    // Of the part's audio data left for the current window (not padded), set
+    // by mt_stt_guard_begin_window():
+    //
+    int window_audio_length;
+
+    // To measure the metrics of the part (see mt_stt_metrics.cpp), locked by
+    // metrics_mutex, because Whisper runs the logits filter of multiple
+    // decoders (best of or beam search) at the same time, by different
+    // threads (this also locks the part's mt_stt_request.parts_metrics):
+    //
+    std::mutex metrics_mutex;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point window_start; // Encoding/decoding.
+    bool decoding; // True, if a token of the current window was sampled.
+    int max_n_tokens; // Of the decoders since the last (re-)start.
+};
+
+
+/** A (not special) token of a part's result.
+ */
+struct mt_stt_part_token
+{
+    whisper_token id;
+    float p;
+    int64_t t0; // In 10 ms units, relative to the part.
+    int64_t t1;
+    size_t text_index; // Of the token's text in the part's text.
+    size_t text_length;
+};
+
+/** A segment of a part's result.
+ */
+struct mt_stt_part_segment
+{
+    int64_t t0; // In 10 ms units, relative to the part.
+    int64_t t1;
+    int token_index; // Of the segment's first token in the part's tokens.
+    int token_count;
+};
+
+/** The result of transcribing a single part of the audio data.
+ */
+struct mt_stt_part_result
+{
+    std::string text;
+    bool degraded; // See mt_stt_part.degraded.
+    std::vector<float> word_probs; // If wanted by the request, only.
+
+    // If wanted by the request, only:
+    //
+    std::vector<struct mt_stt_part_token> tokens;
+    std::vector<struct mt_stt_part_segment> segments;
+};
+
+/** A cached result (see mt_stt_result_cache).
+ */
+struct mt_stt_result_cache_entry
+{
+    std::string key;
+    struct mt_stt_part_result result;
+    bool has_word_probs;
+    bool has_tokens;
+    size_t bytes; // Approx. memory used.
+};
+
+/** Results of transcribed (parts of) audio data, per model.
+ */
+struct mt_stt_result_cache
+{
+    std::mutex mutex;
+    std::atomic<size_t> max_bytes; // Disabled, if 0.
+    size_t bytes;
+    std::list<struct mt_stt_result_cache_entry> entries; // Most recent first.
+    std::unordered_map<
+            std::string, std::list<struct mt_stt_result_cache_entry>::iterator>
+        index;
+};
+
+/** Wraps a loaded model to be used for any number of transcriptions, which may
+ *  also run at the same time (each with its own Whisper state).
+ */
+struct mt_stt_model
+{
+    struct whisper_context * ctx;
+
+    double load_ms;
+
+    // Variant of ggml's CPU backend in use (see mt_stt_get_cpu_variant()):
+    //
+    char const * cpu_variant;
+
+    std::mutex states_mutex;
+    std::vector<struct whisper_state *> idle_states; // To be reused.
+
+    // Tokens of prompts (see mt_stt_prompt.cpp):
+    //
+    std::mutex prompts_mutex;
+    std::unordered_map<std::string, std::vector<whisper_token>> prompts_cache;
+    std::unordered_map<int, std::vector<whisper_token>> registered_prompts;
+    int next_prompt_id;
+
+    // Languages detected, per ID (see mt_stt_language.cpp):
+    //
+    std::mutex languages_mutex;
+    std::unordered_map<std::string, struct mt_stt_language> languages_cache;
+
+    struct mt_stt_result_cache result_cache;
+};
+/**
+ * - Caller takes ownership of return value.
+ */
+char* mt_stt_create_copy(std::string const & str_ref);
+
+/** Log a message with the given level, if logging is active and the level is
+ *  enabled (see mt_stt_log_configure()).
+ *
+ * - Does not block, the message is written by a background thread.
+ */
+void mt_stt_log_printf(
+    enum mt_stt_log_level const level, char const * const format, ...);
+
+/** Start logging (the background thread), if not already started for another
+ *  transcription running at the same time.
+ *
+ * - Each call must be followed by a call of mt_stt_close_log().
+ * - Never fails, problems with the log file just skip logging to the file.
+ */
+void mt_stt_open_log();
+
+/** Stop logging, if this is the last user, after writing all messages.
+ */
+void mt_stt_close_log();
+
+/** Initialize the given request to be started now (it will be aborted by
+ *  following calls of mt_stt_cancel()).
+ */
+void mt_stt_init_request(
+    struct mt_stt_request * const req,
+    struct mt_stt_params const & mt_params_ref,
+    int const parts_count);
+
+/** Returns true, if the given request is cancelled (by mt_stt_cancel() or
+ *  its token) or its deadline passed and marks the request as aborted.
+ */
+bool mt_stt_is_aborted(struct mt_stt_request * const req);
+
+/** Call the given function with the count of threads to use for Whisper.
+ *
+ * - If the thread pool is configured (see mt_stt_thread_pool_configure()),
+ *   the function is called on a free lane of the pool with the lane's count of
+ *   threads (waiting for a lane, if all are busy). Otherwise, it is called
+ *   directly with the given count of threads.
+ * - Returns false without calling the function, if the given request
+ *   (optional) got aborted while waiting for a lane.
+ */
+bool mt_stt_pool_run(
+    struct mt_stt_request * const opt_req,
+    int const n_threads,
+    std::function<void(int)> const & func_ref);
+
+/** Get the key of the given audio data transcribed with the given Whisper
+ *  parameters for the result cache.
+ */
+void mt_stt_cache_get_key(
+    struct whisper_full_params const & params_ref,
+    struct mt_stt_guard const & guard_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    std::string & out_key);
+
+/** Get the result cached for the given key, if it holds everything wanted by
+ *  the given request.
+ *
+ * - Returns false, if not found.
+ */
+bool mt_stt_cache_get(
+    struct mt_stt_result_cache & cache_ref,
+    std::string const & key_ref,
+    struct mt_stt_request const * const req,
+    struct mt_stt_part_result * const out_result);
+
+void mt_stt_cache_put(
+    struct mt_stt_result_cache & cache_ref,
+    std::string const & key_ref,
+    struct mt_stt_request const * const req,
+    struct mt_stt_part_result const & result_ref);
+
+/** Get the resident memory of the process in bytes and the part of it that
+ *  is shared with other processes (e.g. mapped files), 0 if not available.
+ */
+void mt_stt_get_memory_bytes(long long & out_resident, long long & out_shared);
+
+/** Start to measure the given part's metrics (see mt_stt_part_metrics).
+ */
+void mt_stt_metrics_begin_part(
+    struct mt_stt_part * const part, int const audio_data_length);
+
+/** To be called, when the encoder starts for the next window of the part.
+ */
+void mt_stt_metrics_begin_window(struct mt_stt_part * const part);
+
+/** To be called for each token sampled, n_tokens is the count of tokens
+ *  sampled before by the decoder in the current window.
+ */
+void mt_stt_metrics_add_token(
+    struct mt_stt_part * const part, int const n_tokens);
+
+/** To be called, if the result of the part was taken from the cache.
+ */
+void mt_stt_metrics_cache_hit(struct mt_stt_part * const part);
+
+void mt_stt_metrics_end_part(struct mt_stt_part * const part);
+
+/** Fill the given metrics from the given request's part metrics.
+ *
+ * - Also returns the part metrics, if with_parts is true.
+ * - Returns false on error.
+ */
+bool mt_stt_metrics_get(
+    struct mt_stt_model const * const model,
+    struct mt_stt_request const & req_ref,
+    double const total_ms,
+    bool const with_parts,
+    struct mt_stt_metrics * const out_metrics);
+
+/** Get a Whisper state to be used exclusively by one transcription, either
+ *  an idle one that was used before or a new one.
+ *
+ * - Must be given back via mt_stt_release_state().
+ * - Returns NULL on error.
+ */
+struct whisper_state * mt_stt_acquire_state(struct mt_stt_model * const model);
+
+void mt_stt_release_state(
+    struct mt_stt_model * const model, struct whisper_state * const state);
+
+/** Get the tokens of the prompt given by the mt_stt parameters (tokens, ID of
+ *  a registered prompt or text, in this order), empty if none is given.
+ *
+ * - Prompt texts are tokenized once per model and cached.
+ * - Returns false on error (e.g. prompt too long or not registered).
+ */
+bool mt_stt_get_prompt_tokens(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    std::vector<whisper_token> & out_tokens);
+
+/** Returns true, if the given language means to detect the language.
+ */
+bool mt_stt_is_auto_language(char const * const language);
+
+/** Get the language cached for the ID given by the parameters (see
+ *  mt_stt_params.opt_language_cache_key), if any.
+ */
+bool mt_stt_get_cached_language(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    char const * & out_language);
+
+/** Detect the language once for all parts of the audio data, if wanted by
+ *  the given parameters (or get it from the model's cache).
+ *
+ * - Uses the first samples of the given parts or of the speech detected in
+ *   the audio data.
+ * - Uses the given state, if any, otherwise a state of the model's pool.
+ * - Sets out_language to the language to be used (a string of Whisper that
+ *   does not need to be freed) or NULL to let Whisper detect it (as usual).
+ * - Also fills mt_params_ref.opt_out_language, if given.
+ * - Returns false on error.
+ */
+bool mt_stt_detect_language(
+    struct mt_stt_model * const model,
+    struct whisper_state * const opt_state,
+    struct mt_stt_params const & mt_params_ref,
+    int const n_threads,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    char const * & out_language);
+
+/** Get the given decoding parameters (or the defaults, if not given) with
+ *  defaults for the fields unknown to the caller (see
+ *  mt_stt_decoding_params.size).
+ *
+ * - Returns false on error (invalid parameters).
+ */
+bool mt_stt_get_decoding_params(
+    struct mt_stt_decoding_params const * const opt_params,
+    struct mt_stt_decoding_params & out_params);
+
+/** Set the given Whisper parameters from the given decoding parameters.
+ */
+void mt_stt_apply_decoding_params(
+    struct mt_stt_decoding_params const & params_ref,
+    struct whisper_full_params & out_params);
+
+/** Get the settings of the guard from the given decoding parameters (or the
+ *  defaults, if not given).
+ *
+ * - All checks are disabled, if the parameters are invalid.
+ */
+void mt_stt_get_guard(
+    struct mt_stt_decoding_params const * const opt_params,
+    struct mt_stt_guard & out_guard);
+
+/** Estimate the length of the audio data of the window of the given part
+ *  that Whisper is about to encode via the given state (for the guard's
+ *  tokens per second check).
+ *
+ * - To be called by Whisper's encoder begin callback.
+ */
+void mt_stt_guard_begin_window(
+    struct whisper_state * const state, struct mt_stt_part * const part);
+
+/** Check the tokens sampled so far by a decoder of the given part and force
+ *  the end of the segment via the given logits, if the guard triggers.
+ *
+ * - To be called by Whisper's logits filter callback.
+ * - Sets part->degraded, if triggered.
+ */
+void mt_stt_guard_check(
+    struct whisper_context * const ctx,
+    struct mt_stt_part * const part,
+    whisper_token_data const * const tokens,
+    int const n_tokens,
+    float * const logits);
+
+/** Initialize the given Whisper parameters from the given mt_stt parameters.
+ *
+ * - The given prompt tokens vector holds the tokens of the initial prompt (if
+ *   any) and must stay alive as long as the Whisper parameters are used.
+ * - Logs to the log file (which must be open, already).
+ * - Returns false on error (e.g. initial prompt too long).
+ */
+bool mt_stt_init_full_params(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    struct whisper_full_params & params,
+    std::vector<whisper_token> & prompt_tokens);
+
+/** Transcribe one part of the audio data with the given state.
+ *
+ * - Pads the audio data, if it is too short for Whisper and pad is true.
+ * - Uses a reduced encoder context for short audio data, if enabled for the
+ *   request.
+ * - Uses the request's result cache, if any (no_context must be true, then).
+ * - The results are also still available via the state, afterwards (unless
+ *   taken from the cache).
+ * - If aborted, the results so far are returned, if wanted by the request.
+ * - Returns false on error (or if aborted).
+ */
+bool mt_stt_transcribe_part(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    struct whisper_full_params params, // (copied on purpose)
+    struct mt_stt_part * const part,
+    bool const no_context,
+    bool const pad,
+    float const * part_audio_data,
+    int part_audio_data_length,
+    struct mt_stt_part_result * const out_result);
+
+/** Transcribe the given audio data or the given parts of it and get the
+ *  result of each part (or the result of the whole audio data as one part).
+ *
+ * - Also fills mt_params_ref.opt_out_metrics, if given.
+ * - Returns false on error.
+ */
+bool mt_stt_transcribe_results(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    bool const get_word_probs,
+    bool const get_tokens,
+    std::vector<struct mt_stt_part_result> & out_results);
+
+/** Get the name of the variant of ggml's CPU backend in use (e.g. "haswell")
+ *  and log it together with the features of the variant.
+ *
+ * - To be called after a model was loaded [Whisper loads the backends, if
+ *   they are shared libraries (see "make dist")].
+ * - Returned string is static (never NULL).
+ */
+char const * mt_stt_get_cpu_variant();
+
+#endif //MT_STT_INTERNAL
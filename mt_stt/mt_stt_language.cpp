@@ -0,0 +1,316 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Detecting the language once per transcription (instead of letting Whisper
+// detect it for each part), optionally cached per speaker/stream ID.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+//
+static int const s_samples_per_ms = 16;
+
+// Max. count of IDs whose languages are cached per model (the cache is
+// cleared, if full):
+//
+static size_t const s_max_cached_languages = 1024;
+
+bool mt_stt_is_auto_language(char const * const language)
+{
+    return language == nullptr
+        || language[0] == '\0'
+        || strcmp(language, "auto") == 0;
+}
+
+/** Get the language cached for the given ID, if any.
+ */
+static bool get_cached(
+    struct mt_stt_model * const model,
+    char const * const key,
+    struct mt_stt_language & out_language)
+{
+    std::lock_guard<std::mutex> const lock(model->languages_mutex);
+    auto const it = model->languages_cache.find(key);
+
+    if(it == model->languages_cache.end())
+    {
+        return false;
+    }
+    out_language = it->second;
+    return true;
+}
+
+static void add_cached(
+    struct mt_stt_model * const model,
+    char const * const key,
+    struct mt_stt_language const & language_ref)
+{
+    std::lock_guard<std::mutex> const lock(model->languages_mutex);
+
+    if(s_max_cached_languages <= model->languages_cache.size())
+    {
+        model->languages_cache.clear();
+    }
+    model->languages_cache[key] = language_ref;
+}
+
+bool mt_stt_get_cached_language(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    char const * & out_language)
+{
+    struct mt_stt_language language;
+
+    out_language = nullptr;
+    if(mt_params_ref.opt_language_cache_key == nullptr
+        || !get_cached(model, mt_params_ref.opt_language_cache_key, language))
+    {
+        return false;
+    }
+    out_language = language.code;
+    return true;
+}
+
+/** Copy the first max_samples samples of speech to the given vector.
+ *
+ * - Detects speech via mt_stt_detect_speech(), if no parts are given.
+ * - Falls back to the beginning of the audio data, if there is no speech.
+ */
+static void get_speech(
+    struct mt_stt_params const & mt_params_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * opt_parts_audio_data_indices,
+    int const * opt_parts_audio_data_limits,
+    int opt_parts_length,
+    int const max_samples,
+    std::vector<float> & out_samples)
+{
+    int * vad_indices = nullptr;
+    int * vad_limits = nullptr;
+
+    if(opt_parts_audio_data_indices == nullptr)
+    {
+        int const n = mt_stt_detect_speech(
+            &mt_params_ref,
+            audio_data_arr,
+            audio_data_length,
+            &vad_indices,
+            &vad_limits);
+
+        opt_parts_audio_data_indices = vad_indices;
+        opt_parts_audio_data_limits = vad_limits;
+        opt_parts_length = n < 0 ? 0 : n;
+    }
+
+    out_samples.clear();
+    for(int i = 0;
+        i < opt_parts_length && (int)out_samples.size() < max_samples;
+        ++i)
+    {
+        int const begin = opt_parts_audio_data_indices[i];
+        int const n = std::min(
+            opt_parts_audio_data_limits[i] - begin,
+            max_samples - (int)out_samples.size());
+
+        out_samples.insert(
+            out_samples.end(),
+            audio_data_arr + begin,
+            audio_data_arr + begin + n);
+    }
+    if(out_samples.empty())
+    {
+        out_samples.assign(
+            audio_data_arr,
+            audio_data_arr + std::min(audio_data_length, max_samples));
+    }
+
+    mt_stt_free(vad_indices);
+    mt_stt_free(vad_limits);
+}
+
+/** Detect the language of the given samples with the given state.
+ *
+ * - Returns false on error.
+ */
+static bool detect(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    int const n_threads,
+    std::vector<float> const & samples_ref,
+    struct mt_stt_language & out_language)
+{
+    bool mel_ok = false;
+    int id = -1;
+    std::vector<float> probs(whisper_lang_max_id() + 1, 0.0f);
+
+    mt_stt_pool_run(
+        nullptr,
+        n_threads,
+        [&](int const pool_n_threads)
+        {
+            mel_ok = whisper_pcm_to_mel_with_state(
+                    ctx,
+                    state,
+                    samples_ref.data(),
+                    (int)samples_ref.size(),
+                    pool_n_threads) == 0;
+            if(mel_ok)
+            {
+                id = whisper_lang_auto_detect_with_state(
+                    ctx, state, 0, pool_n_threads, probs.data());
+            }
+        });
+
+    if(!mel_ok)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Failed to compute mel spectrogram to detect language!\n");
+        return false;
+    }
+
+    if(id < 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Failed to detect language!\n");
+        return false;
+    }
+    out_language.code = whisper_lang_str(id);
+    out_language.p = probs[id];
+    return true;
+}
+
+bool mt_stt_detect_language(
+    struct mt_stt_model * const model,
+    struct whisper_state * const opt_state,
+    struct mt_stt_params const & mt_params_ref,
+    int const n_threads,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    char const * & out_language)
+{
+    struct mt_stt_language language;
+    char const * const key = mt_params_ref.opt_language_cache_key;
+
+    out_language = nullptr;
+    if(mt_params_ref.opt_out_language != nullptr)
+    {
+        mt_params_ref.opt_out_language->code = nullptr;
+        mt_params_ref.opt_out_language->p = 0.0f;
+    }
+
+    if(!mt_params_ref.detect_language_once
+        || !mt_stt_is_auto_language(mt_params_ref.language)
+        || !whisper_is_multilingual(model->ctx))
+    {
+        return true; // Nothing to do.
+    }
+
+    if(key == nullptr || !get_cached(model, key, language))
+    {
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<float> samples;
+
+        get_speech(
+            mt_params_ref,
+            audio_data_arr,
+            audio_data_length,
+            opt_parts_audio_data_indices,
+            opt_parts_audio_data_limits,
+            opt_parts_length,
+            std::max(1, mt_params_ref.detect_language_ms) * s_samples_per_ms,
+            samples);
+        if(samples.empty())
+        {
+            return true; // No audio data, nothing to detect.
+        }
+
+        struct whisper_state * const state = opt_state != nullptr
+            ? opt_state : mt_stt_acquire_state(model);
+
+        if(state == nullptr)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Failed to create Whisper state!\n");
+            return false;
+        }
+
+        bool const ok = detect(
+            model->ctx, state, n_threads, samples, language);
+
+        if(opt_state == nullptr)
+        {
+            mt_stt_release_state(model, state);
+        }
+        if(!ok)
+        {
+            return false;
+        }
+        if(key != nullptr)
+        {
+            add_cached(model, key, language);
+        }
+
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_INFO,
+            "Detected language \"%s\" (p = %.3f) in %.1f ms.\n",
+            language.code,
+            language.p,
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    else
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_INFO,
+            "Cached language \"%s\" (p = %.3f) used for \"%s\".\n",
+            language.code,
+            language.p,
+            key);
+    }
+
+    out_language = language.code;
+    if(mt_params_ref.opt_out_language != nullptr)
+    {
+        *mt_params_ref.opt_out_language = language;
+    }
+    return true;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_language_cache_clear(
+    struct mt_stt_model * const model, char const * const opt_key)
+{
+    if(model == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> const lock(model->languages_mutex);
+
+    if(opt_key == nullptr)
+    {
+        model->languages_cache.clear();
+        return;
+    }
+    model->languages_cache.erase(opt_key);
+}
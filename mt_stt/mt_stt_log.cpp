@@ -0,0 +1,488 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Asynchronous logging of mt_stt and Whisper: Log messages are put into a
+// lock-free ring buffer by the calling threads and written to the log file
+// and/or given to the user's sink by a background thread.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static char const * const s_default_log_file_path = "mt_stt_log.txt";
+
+// Longer messages are split into multiple slots:
+//
+static int const s_slot_text_size = 240;
+static size_t const s_slot_count = 1024; // Must be a power of two.
+
+// How often the background thread looks for new messages:
+//
+static std::chrono::milliseconds const s_drain_interval(20);
+
+/** An entry of the ring buffer.
+ *
+ * - seq equals the position of a free slot to be written and the position
+ *   plus one of a slot that was written, but not read, yet.
+ */
+struct log_slot
+{
+    std::atomic<size_t> seq;
+    int level;
+    char text[s_slot_text_size + 1];
+};
+
+static struct log_slot s_slots[s_slot_count];
+static std::atomic<size_t> s_enqueue_pos(0);
+static size_t s_dequeue_pos = 0; // Used by the background thread, only.
+static std::atomic<unsigned int> s_dropped(0); // Messages lost (buffer full).
+
+static bool init_slots()
+{
+    for(size_t i = 0; i < s_slot_count; ++i)
+    {
+        s_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    return true;
+}
+static bool const s_slots_initialized = init_slots();
+
+// Configuration (see mt_stt_log_configure()), the level is also read without
+// locking by the logging threads:
+//
+static std::atomic<int> s_level(MT_STT_LOG_LEVEL_INFO);
+static std::mutex s_config_mutex;
+static std::string s_file_path(s_default_log_file_path);
+static bool s_file_path_changed = false;
+static void (*s_sink_func)(
+    enum mt_stt_log_level level, char const * text, void * user_data) = nullptr;
+static void * s_sink_user_data = nullptr;
+
+// The log file, used by the background thread, only (kept open until the
+// log is configured with another path, mt_stt_log_shutdown() is called or
+// the process exits):
+//
+static FILE* s_file = nullptr;
+static bool s_file_failed = false; // Don't try to open the file, again.
+
+// The background thread is started by the first user and runs until the
+// process exits (or mt_stt_log_shutdown() is called), it wakes up
+// periodically while there is at least one user
+// [see mt_stt_open_log() and mt_stt_close_log()], only:
+//
+static std::mutex s_thread_mutex; // For s_users and the flags below.
+static int s_users = 0;
+static std::thread s_thread;
+static std::condition_variable s_thread_wake;
+static bool s_thread_stop = false;
+static bool s_drain_requested = false; // By the last user leaving.
+static std::atomic<bool> s_active(false); // True, if there is any user.
+
+/** Put the given text into the ring buffer, without blocking.
+ *
+ * - Drops the text, if the ring buffer is full.
+ */
+static void enqueue(int const level, char const * const text, size_t len)
+{
+    assert(s_slots_initialized);
+
+    char const * t = text;
+
+    while(0 < len)
+    {
+        size_t const n = std::min(len, (size_t)s_slot_text_size);
+        size_t pos = s_enqueue_pos.load(std::memory_order_relaxed);
+        struct log_slot * slot = nullptr;
+
+        while(true)
+        {
+            slot = &s_slots[pos & (s_slot_count - 1)];
+
+            intptr_t const diff =
+                (intptr_t)slot->seq.load(std::memory_order_acquire)
+                    - (intptr_t)pos;
+
+            if(diff == 0)
+            {
+                if(s_enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break; // Got the slot.
+                }
+                continue; // pos was updated by compare_exchange_weak().
+            }
+            if(diff < 0)
+            {
+                ++s_dropped; // Full.
+                return;
+            }
+            pos = s_enqueue_pos.load(std::memory_order_relaxed);
+        }
+
+        slot->level = level;
+        memcpy(slot->text, t, n);
+        slot->text[n] = '\0';
+        slot->seq.store(pos + 1, std::memory_order_release);
+
+        t += n;
+        len -= n;
+    }
+}
+
+/** The configuration used by the background thread for one drain() call
+ *  (copied, to call the sink without holding a lock, so it may call any
+ *  function of the library).
+ */
+struct drain_config
+{
+    std::string file_path; // Set, if the file is to be opened, only.
+    void (*sink_func)(
+        enum mt_stt_log_level level, char const * text, void * user_data);
+    void * sink_user_data;
+};
+
+/** Write the given text to the log file and give it to the sink.
+ *
+ * - Must be called by the background thread.
+ */
+static void write_message(
+    struct drain_config const & config_ref,
+    int const level,
+    char const * const text)
+{
+    if(s_file == nullptr && !s_file_failed && !config_ref.file_path.empty())
+    {
+#ifdef _WIN32
+        s_file = _fsopen(config_ref.file_path.c_str(), "a", SH_DENYWR);
+#else //_WIN32
+        s_file = fopen(config_ref.file_path.c_str(), "a");
+#endif //_WIN32
+        s_file_failed = s_file == nullptr; // Logging to file is skipped.
+    }
+    if(s_file != nullptr)
+    {
+        fputs(text, s_file);
+    }
+    if(config_ref.sink_func != nullptr)
+    {
+        config_ref.sink_func(
+            (enum mt_stt_log_level)level, text, config_ref.sink_user_data);
+    }
+}
+
+/** Write all messages that are in the ring buffer.
+ *
+ * - Must be called by the background thread.
+ */
+static void drain()
+{
+    struct drain_config config;
+
+    {
+        std::lock_guard<std::mutex> const lock(s_config_mutex);
+
+        if(s_file_path_changed)
+        {
+            if(s_file != nullptr)
+            {
+                fclose(s_file);
+                s_file = nullptr;
+            }
+            s_file_failed = false;
+            s_file_path_changed = false;
+        }
+        if(s_file == nullptr && !s_file_failed)
+        {
+            config.file_path = s_file_path;
+        }
+        config.sink_func = s_sink_func;
+        config.sink_user_data = s_sink_user_data;
+    }
+
+    unsigned int const dropped = s_dropped.exchange(0);
+
+    if(dropped != 0)
+    {
+        char buf[64];
+
+        snprintf(
+            buf, sizeof buf, "(%u log message(s) dropped)\n", dropped);
+        write_message(config, MT_STT_LOG_LEVEL_WARN, buf);
+    }
+
+    // Messages queued later (e.g. by the sink) are written by the next call:
+    //
+    size_t const limit = s_enqueue_pos.load(std::memory_order_acquire);
+
+    while(s_dequeue_pos != limit)
+    {
+        struct log_slot * const slot =
+            &s_slots[s_dequeue_pos & (s_slot_count - 1)];
+
+        if(slot->seq.load(std::memory_order_acquire) != s_dequeue_pos + 1)
+        {
+            break; // Empty (or the next slot is still being written).
+        }
+
+        write_message(config, slot->level, slot->text);
+
+        slot->seq.store(
+            s_dequeue_pos + s_slot_count, std::memory_order_release);
+        ++s_dequeue_pos;
+    }
+
+    if(s_file != nullptr)
+    {
+        fflush(s_file); // Once per drain, not once per message.
+    }
+}
+
+static void run_thread()
+{
+    std::unique_lock<std::mutex> lock(s_thread_mutex);
+
+    while(!s_thread_stop)
+    {
+        if(0 < s_users)
+        {
+            s_thread_wake.wait_for(
+                lock, s_drain_interval, []{ return s_thread_stop; });
+        }
+        else // => Sleep until the next user (or the exit).
+        {
+            s_thread_wake.wait(
+                lock,
+                []
+                {
+                    return s_thread_stop || 0 < s_users || s_drain_requested;
+                });
+        }
+        s_drain_requested = false;
+
+        lock.unlock();
+        drain(); // (also writes the remaining messages before exiting)
+        lock.lock();
+    }
+}
+
+/** Stop the background thread (after writing the remaining messages) and
+ *  close the log file.
+ */
+static void stop_thread()
+{
+    {
+        std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+        s_thread_stop = true;
+    }
+    s_thread_wake.notify_one();
+    if(s_thread.joinable())
+    {
+        s_thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+        s_thread_stop = false; // (started again by the next user)
+    }
+    if(s_file != nullptr)
+    {
+        fclose(s_file);
+        s_file = nullptr;
+    }
+}
+
+/** Stops the background thread, when the process exits (or the library is
+ *  unloaded).
+ *
+ * - On Windows, this runs while holding the loader lock, which a thread
+ *   needs to exit, so joining it would deadlock. The thread is just told to
+ *   stop and detached, there (see mt_stt_log_shutdown()).
+ */
+struct log_thread_stopper
+{
+    ~log_thread_stopper()
+    {
+#ifdef _WIN32
+        if(s_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+                s_thread_stop = true;
+            }
+            s_thread_wake.notify_one();
+            s_thread.detach();
+        }
+#else //_WIN32
+        stop_thread();
+#endif //_WIN32
+    }
+};
+//
+// Destroyed before the variables it uses (defined later):
+//
+static struct log_thread_stopper s_thread_stopper;
+
+/** Get the level of a message from Whisper (or GGML).
+ */
+static int get_level(ggml_log_level const level)
+{
+    // Level of the last message of this thread, for continuations:
+    //
+    static thread_local int last = MT_STT_LOG_LEVEL_INFO;
+
+    switch(level)
+    {
+        case GGML_LOG_LEVEL_ERROR:
+            last = MT_STT_LOG_LEVEL_ERROR;
+            break;
+        case GGML_LOG_LEVEL_WARN:
+            last = MT_STT_LOG_LEVEL_WARN;
+            break;
+        case GGML_LOG_LEVEL_DEBUG:
+            last = MT_STT_LOG_LEVEL_DEBUG;
+            break;
+        case GGML_LOG_LEVEL_CONT:
+            break; // Same level as the last message.
+        default:
+            last = MT_STT_LOG_LEVEL_INFO;
+            break;
+    }
+    return last;
+}
+
+static void on_log(ggml_log_level level, const char * text, void* user_data)
+{
+    (void)user_data;
+
+    int const mt_level = get_level(level);
+
+    if(!s_active.load(std::memory_order_relaxed)
+        || s_level.load(std::memory_order_relaxed) < mt_level)
+    {
+        return;
+    }
+    enqueue(mt_level, text, strlen(text));
+}
+
+void mt_stt_log_printf(
+    enum mt_stt_log_level const level, char const * const format, ...)
+{
+    if(!s_active.load(std::memory_order_relaxed)
+        || s_level.load(std::memory_order_relaxed) < (int)level)
+    {
+        return;
+    }
+
+    char buf[1024];
+    va_list args;
+
+    va_start(args, format);
+    int const len = vsnprintf(buf, sizeof buf, format, args);
+    va_end(args);
+
+    if(len <= 0)
+    {
+        return;
+    }
+    enqueue((int)level, buf, std::min((size_t)len, sizeof buf - 1));
+}
+
+void mt_stt_open_log()
+{
+    static std::once_flag log_set_flag;
+
+    std::call_once(log_set_flag, []{ whisper_log_set(on_log, NULL); });
+
+    {
+        std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+        if(!s_thread.joinable())
+        {
+            // Once per process (or after mt_stt_log_shutdown()):
+            //
+            s_thread = std::thread(run_thread);
+        }
+        ++s_users;
+        s_active = true;
+    }
+    s_thread_wake.notify_one();
+}
+
+void mt_stt_close_log()
+{
+    {
+        std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+        assert(0 < s_users);
+
+        --s_users;
+        if(0 < s_users)
+        {
+            return;
+        }
+        s_active = false;
+        s_drain_requested = true;
+    }
+
+    // Let the background thread write the remaining messages right away
+    // (without waiting for it, the log file stays open):
+    //
+    s_thread_wake.notify_one();
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_log_shutdown()
+{
+    {
+        std::lock_guard<std::mutex> const lock(s_thread_mutex);
+
+        if(0 < s_users)
+        {
+            return false;
+        }
+    }
+    stop_thread();
+    return true;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_log_configure(
+    enum mt_stt_log_level const level,
+    char const * const opt_file_path,
+    void (*opt_sink_func)(
+        enum mt_stt_log_level level, char const * text, void * user_data),
+    void * const user_data)
+{
+    std::lock_guard<std::mutex> const lock(s_config_mutex);
+
+    s_level = (int)level;
+
+    std::string const file_path(opt_file_path == nullptr ? "" : opt_file_path);
+
+    if(file_path != s_file_path)
+    {
+        s_file_path = file_path;
+        s_file_path_changed = true; // (closes the file, see drain())
+    }
+    s_sink_func = opt_sink_func;
+    s_sink_user_data = user_data;
+}
@@ -0,0 +1,255 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Measures the metrics of transcriptions via Whisper's callbacks (Whisper's
+// own timings are not available per state).
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else //_WIN32
+    #include <sys/resource.h>
+    #include <unistd.h>
+#endif //_WIN32
+
+static double get_ms_since(std::chrono::steady_clock::time_point const start)
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+/** Get the peak resident memory of the process in bytes (0 on error).
+ */
+static long long get_peak_memory_bytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+    {
+        return 0;
+    }
+    return (long long)counters.PeakWorkingSetSize;
+#else //_WIN32
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    #ifdef __APPLE__
+        return (long long)usage.ru_maxrss; // In bytes.
+    #else //__APPLE__
+        return (long long)usage.ru_maxrss * 1024LL; // In kilobytes.
+    #endif //__APPLE__
+#endif //_WIN32
+}
+
+void mt_stt_get_memory_bytes(long long & out_resident, long long & out_shared)
+{
+    out_resident = 0;
+    out_shared = 0;
+
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+    {
+        out_resident = (long long)counters.WorkingSetSize;
+    }
+#elif defined(__linux__)
+    // Sizes in pages: Total, resident and resident shared (file-backed):
+    //
+    FILE * const file = fopen("/proc/self/statm", "r");
+    long long size, resident, shared;
+
+    if(file == nullptr)
+    {
+        return;
+    }
+    if(fscanf(file, "%lld %lld %lld", &size, &resident, &shared) == 3)
+    {
+        long long const page_size = (long long)sysconf(_SC_PAGESIZE);
+
+        out_resident = resident * page_size;
+        out_shared = shared * page_size;
+    }
+    fclose(file);
+#endif //_WIN32
+}
+
+void mt_stt_metrics_begin_part(
+    struct mt_stt_part * const part, int const audio_data_length)
+{
+    struct mt_stt_part_metrics & metrics_ref =
+        part->req->parts_metrics[part->index];
+
+    memset(&metrics_ref, 0, sizeof metrics_ref);
+
+    // * Hard-coded for a sample rate of 16000 Hz!
+    //
+    metrics_ref.audio_ms = (double)audio_data_length / 16.0;
+
+    part->start = std::chrono::steady_clock::now();
+    part->window_start = part->start;
+    part->decoding = false;
+    part->max_n_tokens = 0;
+}
+
+void mt_stt_metrics_begin_window(struct mt_stt_part * const part)
+{
+    std::lock_guard<std::mutex> const lock(part->metrics_mutex);
+    struct mt_stt_part_metrics & metrics_ref =
+        part->req->parts_metrics[part->index];
+    double const ms = get_ms_since(part->window_start);
+
+    if(metrics_ref.encoder_runs == 0)
+    {
+        metrics_ref.mel_ms += ms;
+    }
+    else if(part->decoding)
+    {
+        metrics_ref.decode_ms += ms;
+    }
+    else // => No token sampled for the last window.
+    {
+        metrics_ref.encode_ms += ms;
+    }
+
+    ++metrics_ref.encoder_runs;
+    part->window_start = std::chrono::steady_clock::now();
+    part->decoding = false;
+    part->max_n_tokens = 0;
+}
+
+void mt_stt_metrics_add_token(
+    struct mt_stt_part * const part, int const n_tokens)
+{
+    // Called by multiple threads at the same time, if Whisper uses more than
+    // one decoder:
+    //
+    std::lock_guard<std::mutex> const lock(part->metrics_mutex);
+    struct mt_stt_part_metrics & metrics_ref =
+        part->req->parts_metrics[part->index];
+
+    if(!part->decoding)
+    {
+        metrics_ref.encode_ms += get_ms_since(part->window_start);
+        part->window_start = std::chrono::steady_clock::now();
+        part->decoding = true;
+    }
+    else if(n_tokens == 0 && 0 < part->max_n_tokens)
+    {
+        // The decoders started again for the same window, which Whisper does
+        // with a higher temperature, if the result was not good enough.
+        //
+        // All decoders of a step share the same count, so resetting the
+        // maximum makes sure that only the first decoder restarting counts:
+        //
+        ++metrics_ref.fallbacks;
+        part->max_n_tokens = 0;
+    }
+
+    ++metrics_ref.tokens;
+    if(part->max_n_tokens < n_tokens)
+    {
+        part->max_n_tokens = n_tokens;
+    }
+}
+
+void mt_stt_metrics_cache_hit(struct mt_stt_part * const part)
+{
+    std::lock_guard<std::mutex> const lock(part->metrics_mutex);
+
+    part->req->parts_metrics[part->index].cache_hits = 1;
+}
+
+void mt_stt_metrics_end_part(struct mt_stt_part * const part)
+{
+    std::lock_guard<std::mutex> const lock(part->metrics_mutex);
+    struct mt_stt_part_metrics & metrics_ref =
+        part->req->parts_metrics[part->index];
+    double const ms = get_ms_since(part->window_start);
+
+    if(part->decoding)
+    {
+        metrics_ref.decode_ms += ms;
+    }
+    else if(0 < metrics_ref.encoder_runs)
+    {
+        metrics_ref.encode_ms += ms;
+    }
+    else
+    {
+        metrics_ref.mel_ms += ms;
+    }
+    metrics_ref.total_ms = get_ms_since(part->start);
+    metrics_ref.degraded = part->degraded ? 1 : 0;
+}
+
+bool mt_stt_metrics_get(
+    struct mt_stt_model const * const model,
+    struct mt_stt_request const & req_ref,
+    double const total_ms,
+    bool const with_parts,
+    struct mt_stt_metrics * const out_metrics)
+{
+    memset(out_metrics, 0, sizeof *out_metrics);
+
+    out_metrics->load_ms = model->load_ms;
+    out_metrics->cpu_variant = model->cpu_variant;
+    out_metrics->total_ms = total_ms;
+
+    for(struct mt_stt_part_metrics const & part_ref : req_ref.parts_metrics)
+    {
+        out_metrics->audio_ms += part_ref.audio_ms;
+        out_metrics->mel_ms += part_ref.mel_ms;
+        out_metrics->encode_ms += part_ref.encode_ms;
+        out_metrics->decode_ms += part_ref.decode_ms;
+        out_metrics->encoder_runs += part_ref.encoder_runs;
+        out_metrics->tokens += part_ref.tokens;
+        out_metrics->fallbacks += part_ref.fallbacks;
+        out_metrics->cache_hits += part_ref.cache_hits;
+        out_metrics->degraded_parts += part_ref.degraded;
+    }
+    if(0.0 < out_metrics->audio_ms)
+    {
+        out_metrics->rtf = total_ms / out_metrics->audio_ms;
+    }
+    out_metrics->peak_memory_bytes = get_peak_memory_bytes();
+    mt_stt_get_memory_bytes(
+        out_metrics->resident_memory_bytes, out_metrics->shared_memory_bytes);
+
+    if(!with_parts)
+    {
+        return true;
+    }
+
+    size_t const bytes =
+        req_ref.parts_metrics.size() * sizeof *out_metrics->parts;
+
+    out_metrics->parts = (struct mt_stt_part_metrics *)malloc(bytes);
+    if(out_metrics->parts == nullptr)
+    {
+        return false; // Must not get here.
+    }
+    memcpy(out_metrics->parts, req_ref.parts_metrics.data(), bytes);
+    out_metrics->parts_count = (int)req_ref.parts_metrics.size();
+    return true;
+}
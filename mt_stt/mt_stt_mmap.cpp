@@ -0,0 +1,209 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Memory-mapping model files read-only, so the model data comes straight
+// from the OS' page cache (shared by all processes mapping the same file)
+// instead of being read into (another) private buffer.
+//
+// - Whisper copies the weights into its own (backend) buffers while loading,
+//   so the mapping is only needed until the model is loaded.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <chrono>
+#include <cstdint>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else //_WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif //_WIN32
+
+/** Read one byte of each page of the given mapped data, to have all pages
+ *  resident before Whisper reads them.
+ */
+static void prefault(void const * const data, size_t const len)
+{
+    static size_t const page_size = 4096; // (larger pages are fine, too)
+
+    unsigned char const * const bytes = (unsigned char const *)data;
+    unsigned char volatile sum = 0;
+
+#ifndef _WIN32
+    // Let the OS read ahead all of the file at once:
+    //
+    madvise((void *)data, len, MADV_WILLNEED);
+#endif //_WIN32
+
+    for(size_t i = 0; i < len; i += page_size)
+    {
+        sum = sum + bytes[i];
+    }
+    (void)sum;
+}
+
+/**
+ * - Returns NULL on error.
+ */
+static void * map_file(
+    char const * const model_file_path,
+    bool const prefault_pages,
+    size_t * const out_len)
+{
+    auto const start = std::chrono::steady_clock::now();
+    void * ret_val = nullptr;
+    size_t len = 0;
+
+#ifdef _WIN32
+    HANDLE const file = CreateFileA(
+        model_file_path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+
+    if(GetFileSizeEx(file, &size) && 0 < size.QuadPart)
+    {
+        HANDLE const mapping = CreateFileMappingA(
+            file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if(mapping != nullptr)
+        {
+            ret_val = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); // (the view keeps the mapping alive)
+        }
+        len = (size_t)size.QuadPart;
+    }
+    CloseHandle(file);
+#else //_WIN32
+    int const fd = open(model_file_path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st) == 0 && 0 < st.st_size)
+    {
+        len = (size_t)st.st_size;
+        ret_val = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+        if(ret_val == MAP_FAILED)
+        {
+            ret_val = nullptr;
+        }
+        else
+        {
+            // Whisper reads the model from the beginning to the end:
+            //
+            madvise(ret_val, len, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd); // (the mapping stays valid)
+#endif //_WIN32
+
+    if(ret_val == nullptr)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Failed to map model file \"%s\"!\n",
+            model_file_path);
+        return nullptr;
+    }
+
+    if(prefault_pages)
+    {
+        prefault(ret_val, len);
+    }
+
+    long long resident, shared;
+
+    mt_stt_get_memory_bytes(resident, shared);
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "Mapped model file \"%s\" (%zu MB, prefault: %d) in %.1f ms, resident:"
+            " %lld MB, shared: %lld MB.\n",
+        model_file_path,
+        len / (1024 * 1024),
+        (int)prefault_pages,
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(),
+        resident / (1024 * 1024),
+        shared / (1024 * 1024));
+
+    *out_len = len;
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void * __stdcall mt_stt_model_map(
+    char const * const model_file_path,
+    bool const prefault_pages,
+    size_t * const out_len)
+{
+    if(model_file_path == nullptr || out_len == nullptr)
+    {
+        return nullptr;
+    }
+
+    mt_stt_open_log();
+
+    void * const ret_val = map_file(model_file_path, prefault_pages, out_len);
+
+    mt_stt_close_log();
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_model_unmap(
+    void * const model_data, size_t const model_data_len)
+{
+    if(model_data == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    (void)model_data_len;
+    UnmapViewOfFile(model_data);
+#else //_WIN32
+    munmap(model_data, model_data_len);
+#endif //_WIN32
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_mapped(
+    bool const use_gpu,
+    char const * const model_file_path,
+    bool const prefault_pages)
+{
+    size_t len = 0;
+    void * const data = mt_stt_model_map(model_file_path, prefault_pages, &len);
+
+    if(data == nullptr)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_model * const ret_val =
+        mt_stt_model_load_from_data(use_gpu, data, len);
+
+    mt_stt_model_unmap(data, len);
+    return ret_val;
+}
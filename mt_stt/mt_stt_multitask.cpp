@@ -0,0 +1,472 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Transcribing and translating to English with one mel spectrogram and one
+// encoder pass per window: Whisper's decoder is run twice on the encoder's
+// output of the same state, once per task (greedy, without timestamps), via
+// Whisper's low-level functions [whisper_full() always encodes, again].
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+
+static int const s_window_frames = 3000; // 30 seconds, 10 ms per mel frame.
+
+// Shorter last windows (of parts longer than one window) are skipped, as
+// Whisper does:
+//
+static int const s_min_window_frames = 100; // 1 second.
+
+// Shorter parts are padded (as mt_stt_transcribe_part() does):
+//
+static int const s_min_samples = 16000 + 384;
+
+/** The result of one task.
+ */
+struct task_result
+{
+    std::string text;
+    std::vector<float> word_probs;
+};
+
+/** Decode the window encoded last by the given state greedily for the given
+ *  task token and append the text to the given result.
+ *
+ * - Returns false on error (or if aborted).
+ */
+static bool decode_window(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    struct mt_stt_request * const req,
+    int const n_threads,
+    std::vector<whisper_token> const & prompt_ref,
+    whisper_token const task,
+    whisper_token const tok_blank,
+    struct task_result & out_result)
+{
+    whisper_token const tok_eot = whisper_token_eot(ctx);
+    int const n_vocab = whisper_n_vocab(ctx);
+    int const n_text_ctx = whisper_n_text_ctx(ctx);
+    int const max_tokens = n_text_ctx / 2 - 4; // As Whisper does.
+    std::vector<whisper_token> tokens(prompt_ref);
+    int n_past = 0;
+
+    tokens.push_back(task);
+    tokens.push_back(whisper_token_not(ctx));
+
+    // The prompt and the tokens sampled must fit into the text context:
+    //
+    for(int i = 0; i < max_tokens && (int)tokens.size() <= n_text_ctx; ++i)
+    {
+        if(mt_stt_is_aborted(req))
+        {
+            return false;
+        }
+
+        int const n_new = (int)tokens.size() - n_past;
+
+        if(whisper_decode_with_state(
+                ctx, state, tokens.data() + n_past, n_new, n_past, n_threads)
+            != 0)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR, "Error: Failed to decode!\n");
+            return false;
+        }
+        n_past = (int)tokens.size();
+
+        // Greedy, text tokens and end of text only (as Whisper does, the
+        // first token must not be blank). Only the logits of the last token
+        // given are computed:
+        //
+        float const * const logits = whisper_get_logits_from_state(state)
+            + (size_t)(n_new - 1) * (size_t)n_vocab;
+        whisper_token best = -1;
+        float max_logit = -INFINITY;
+
+        for(whisper_token id = 0; id <= tok_eot && id < n_vocab; ++id)
+        {
+            if(i == 0 && (id == tok_eot || id == tok_blank))
+            {
+                continue;
+            }
+            if(max_logit < logits[id])
+            {
+                max_logit = logits[id];
+                best = id;
+            }
+        }
+        if(best < 0 || best == tok_eot)
+        {
+            break;
+        }
+
+        double sum = 0.0;
+
+        for(whisper_token id = 0; id <= tok_eot && id < n_vocab; ++id)
+        {
+            sum += std::exp((double)(logits[id] - max_logit));
+        }
+
+        char const * const text = whisper_token_to_str(ctx, best);
+
+        // One probability per word (see get_result() in mt_stt.cpp):
+        //
+        if(std::isspace(static_cast<unsigned char>(text[0])))
+        {
+            out_result.word_probs.push_back((float)(1.0 / sum));
+        }
+        out_result.text += text;
+        tokens.push_back(best);
+    }
+    return true;
+}
+
+/** Transcribe and translate the given audio data of a part.
+ *
+ * - Returns false on error (or if aborted).
+ */
+static bool run_part(
+    struct whisper_context * const ctx,
+    struct whisper_state * const state,
+    struct mt_stt_request * const req,
+    int const n_threads,
+    float const * samples,
+    int n_samples,
+    std::vector<whisper_token> const & prompt_ref,
+    whisper_token const tok_blank,
+    struct task_result & out_transcription,
+    struct task_result & out_translation)
+{
+    static thread_local std::vector<float> min_buf; // Reused per thread.
+
+    if(n_samples < s_min_samples)
+    {
+        min_buf.assign(s_min_samples, 0.0f);
+        std::copy(samples, samples + n_samples, min_buf.begin());
+        samples = min_buf.data();
+        n_samples = s_min_samples;
+    }
+
+    if(whisper_pcm_to_mel_with_state(
+            ctx, state, samples, n_samples, n_threads) != 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Failed to compute mel spectrogram!\n");
+        return false;
+    }
+
+    int const n_frames = whisper_n_len_from_state(state);
+
+    for(int offset = 0;
+        offset == 0 || offset + s_min_window_frames < n_frames;
+        offset += s_window_frames)
+    {
+        if(mt_stt_is_aborted(req))
+        {
+            return false;
+        }
+        if(whisper_encode_with_state(ctx, state, offset, n_threads) != 0)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR, "Error: Failed to encode!\n");
+            return false;
+        }
+
+        // Both decoders use the encoder's output of this window:
+        //
+        if(!decode_window(
+                ctx,
+                state,
+                req,
+                n_threads,
+                prompt_ref,
+                whisper_token_transcribe(ctx),
+                tok_blank,
+                out_transcription)
+            || !decode_window(
+                ctx,
+                state,
+                req,
+                n_threads,
+                prompt_ref,
+                whisper_token_translate(ctx),
+                tok_blank,
+                out_translation))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Transcribe and translate all parts (or the whole audio data).
+ *
+ * - Returns false on error (or if aborted).
+ */
+static bool run(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    struct mt_stt_request * const req,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    struct task_result & out_transcription,
+    struct task_result & out_translation)
+{
+    struct whisper_context * const ctx = model->ctx;
+    std::vector<whisper_token> prompt, prompt_tokens;
+    int n_threads = mt_params_ref.n_threads;
+
+    if(n_threads <= 0)
+    {
+        n_threads =
+            whisper_full_default_params(WHISPER_SAMPLING_GREEDY).n_threads;
+    }
+
+    // The language is needed by both decoders, so it is detected once (from
+    // the first speech), if not given:
+    //
+    struct mt_stt_params detect_params = mt_params_ref;
+    char const * language = mt_params_ref.language;
+
+    detect_params.detect_language_once = true;
+    if(mt_stt_is_auto_language(language))
+    {
+        if(!mt_stt_detect_language(
+                model,
+                nullptr,
+                detect_params,
+                n_threads,
+                audio_data_arr,
+                audio_data_length,
+                opt_parts_audio_data_indices,
+                opt_parts_audio_data_limits,
+                opt_parts_length,
+                language))
+        {
+            return false;
+        }
+        if(language == nullptr)
+        {
+            language = "en"; // E.g. English-only model.
+        }
+    }
+
+    int const lang_id = whisper_lang_id(language);
+
+    if(lang_id < 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Unknown language \"%s\"!\n",
+            language);
+        return false;
+    }
+    if(!mt_stt_get_prompt_tokens(model, mt_params_ref, prompt_tokens))
+    {
+        return false;
+    }
+
+    // Prompt (if any), start of transcript and language, the task and "no
+    // timestamps" are added per decoder.
+    //
+    // Only the last prompt tokens are used, leaving (at least) half of the
+    // text context for decoding, as Whisper does:
+    //
+    if(!prompt_tokens.empty())
+    {
+        size_t const max_prompt_tokens =
+            (size_t)(whisper_n_text_ctx(ctx) / 2 - 4);
+
+        prompt.push_back(whisper_token_prev(ctx));
+        prompt.insert(
+            prompt.end(),
+            max_prompt_tokens < prompt_tokens.size()
+                ? prompt_tokens.end() - max_prompt_tokens
+                : prompt_tokens.begin(),
+            prompt_tokens.end());
+    }
+    prompt.push_back(whisper_token_sot(ctx));
+    if(whisper_is_multilingual(ctx))
+    {
+        prompt.push_back(whisper_token_lang(ctx, lang_id));
+    }
+
+    whisper_token tok_blank = -1;
+
+    if(whisper_tokenize(ctx, " ", &tok_blank, 1) != 1)
+    {
+        tok_blank = -1;
+    }
+
+    struct whisper_state * const state = mt_stt_acquire_state(model);
+
+    if(state == nullptr)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Failed to create Whisper state!\n");
+        return false;
+    }
+
+    int const parts_count = 0 < opt_parts_length ? opt_parts_length : 1;
+    bool ok = true;
+
+    for(int i = 0; i < parts_count && ok; ++i)
+    {
+        int const first = opt_parts_length == 0
+            ? 0 : opt_parts_audio_data_indices[i];
+        int const limit = opt_parts_length == 0
+            ? audio_data_length : opt_parts_audio_data_limits[i];
+
+        if(first < 0 || limit <= first || audio_data_length < limit)
+        {
+            ok = false;
+            break;
+        }
+
+        bool const ran = mt_stt_pool_run(
+            req,
+            n_threads,
+            [&](int const pool_n_threads)
+            {
+                ok = run_part(
+                    ctx,
+                    state,
+                    req,
+                    pool_n_threads,
+                    audio_data_arr + first,
+                    limit - first,
+                    prompt,
+                    tok_blank,
+                    out_transcription,
+                    out_translation);
+            });
+
+        ok = ran && ok;
+    }
+
+    mt_stt_release_state(model, state);
+    return ok;
+}
+
+/** Set the given outputs to the given word probabilities (if wanted).
+ */
+static void set_word_probs(
+    std::vector<float> const & probs_ref,
+    float * * const opt_out_word_probs,
+    int * const opt_out_word_probs_count)
+{
+    if(opt_out_word_probs == nullptr)
+    {
+        return;
+    }
+    *opt_out_word_probs = nullptr;
+    *opt_out_word_probs_count = (int)probs_ref.size();
+    if(probs_ref.empty())
+    {
+        return;
+    }
+    *opt_out_word_probs =
+        (float *)malloc(probs_ref.size() * sizeof *probs_ref.data());
+    memcpy(
+        *opt_out_word_probs,
+        probs_ref.data(),
+        probs_ref.size() * sizeof *probs_ref.data());
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_transcribe_and_translate(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length,
+    char* * const out_text,
+    char* * const out_translation,
+    float * * const opt_out_word_probs,
+    int * const opt_out_word_probs_count,
+    float * * const opt_out_translation_word_probs,
+    int * const opt_out_translation_word_probs_count)
+{
+    if(model == nullptr || params == nullptr || audio_data_arr == nullptr
+        || audio_data_length <= 0 || out_text == nullptr
+        || out_translation == nullptr
+        || ((opt_out_word_probs == nullptr)
+            != (opt_out_word_probs_count == nullptr))
+        || ((opt_out_translation_word_probs == nullptr)
+            != (opt_out_translation_word_probs_count == nullptr))
+        || ((opt_parts_audio_data_indices == nullptr)
+            != (opt_parts_length <= 0))
+        || ((opt_parts_audio_data_limits == nullptr)
+            != (opt_parts_length <= 0)))
+    {
+        return false;
+    }
+
+    struct mt_stt_request req;
+    struct task_result transcription, translation;
+
+    mt_stt_open_log();
+
+    if(params->opt_out_aborted != nullptr)
+    {
+        *params->opt_out_aborted = false;
+    }
+    mt_stt_init_request(&req, *params, 1); // (the timeout starts here)
+
+    bool const ok = run(
+        model,
+        *params,
+        &req,
+        audio_data_arr,
+        audio_data_length,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits,
+        opt_parts_length < 0 ? 0 : opt_parts_length,
+        transcription,
+        translation);
+
+    mt_stt_close_log();
+
+    if(params->opt_out_aborted != nullptr)
+    {
+        *params->opt_out_aborted = req.aborted;
+    }
+    if(!ok)
+    {
+        return false;
+    }
+
+    *out_text = mt_stt_create_copy(transcription.text);
+    *out_translation = mt_stt_create_copy(translation.text);
+    set_word_probs(
+        transcription.word_probs,
+        opt_out_word_probs,
+        opt_out_word_probs_count);
+    set_word_probs(
+        translation.word_probs,
+        opt_out_translation_word_probs,
+        opt_out_translation_word_probs_count);
+    return true;
+}
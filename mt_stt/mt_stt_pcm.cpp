@@ -0,0 +1,575 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Conversion of PCM audio data in different formats (sample type, channels
+// and sample rate) into the mono, 32-bit float, 16 kHz audio data needed by
+// Whisper.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && 2 <= _M_IX86_FP)
+    #define MT_STT_SSE2
+    #include <emmintrin.h>
+#endif //__SSE2__ ...
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif //__ARM_NEON
+
+static int const s_whisper_sample_rate = 16000;
+
+// Reused by all conversions of the same thread (to avoid allocations, they are
+// released after a conversion, if larger than s_max_kept_samples):
+//
+static thread_local std::vector<float> s_buf; // Converted, input sample rate.
+static thread_local std::vector<float> s_resampled; // Converted, 16 kHz.
+//
+static size_t const s_max_kept_samples = 2 * 1024 * 1024; // 8 MB each.
+
+static void convert_s16(
+    int16_t const * const in, float * const out, size_t const n)
+{
+    static float const scale = 1.0f / 32768.0f;
+    size_t i = 0;
+
+#if defined(MT_STT_SSE2)
+    __m128 const v_scale = _mm_set1_ps(scale);
+
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i const s = _mm_loadu_si128((__m128i const *)(in + i));
+
+        // Sign-extend by moving each 16-bit value to the upper half of a
+        // 32-bit value and shifting it back arithmetically:
+        //
+        __m128i const lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i const hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), v_scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), v_scale));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t const v_scale = vdupq_n_f32(scale);
+
+    for(; i + 8 <= n; i += 8)
+    {
+        int16x8_t const s = vld1q_s16(in + i);
+
+        vst1q_f32(
+            out + i,
+            vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), v_scale));
+        vst1q_f32(
+            out + i + 4,
+            vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), v_scale));
+    }
+#endif //MT_STT_SSE2
+
+    for(; i < n; ++i)
+    {
+        out[i] = (float)in[i] * scale;
+    }
+}
+
+static void convert_s32(
+    int32_t const * const in, float * const out, size_t const n)
+{
+    static float const scale = 1.0f / 2147483648.0f;
+    size_t i = 0;
+
+#if defined(MT_STT_SSE2)
+    __m128 const v_scale = _mm_set1_ps(scale);
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i const s = _mm_loadu_si128((__m128i const *)(in + i));
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(s), v_scale));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t const v_scale = vdupq_n_f32(scale);
+
+    for(; i + 4 <= n; i += 4)
+    {
+        vst1q_f32(
+            out + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(in + i)), v_scale));
+    }
+#endif //MT_STT_SSE2
+
+    for(; i < n; ++i)
+    {
+        out[i] = (float)in[i] * scale;
+    }
+}
+
+/** Replace each pair of values by their mean, writing n / 2 values to out.
+ *
+ * - Used for down-mixing stereo to mono and for down-sampling by factor 2.
+ * - in and out may be the same.
+ */
+static void mean_of_pairs(
+    float const * const in, float * const out, size_t const n)
+{
+    size_t const n_out = n / 2;
+    size_t i = 0;
+
+#if defined(MT_STT_SSE2)
+    __m128 const half = _mm_set1_ps(0.5f);
+
+    for(; i + 4 <= n_out; i += 4)
+    {
+        __m128 const a = _mm_loadu_ps(in + 2 * i); // L0 R0 L1 R1
+        __m128 const b = _mm_loadu_ps(in + 2 * i + 4); // L2 R2 L3 R3
+        __m128 const l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 const r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t const half = vdupq_n_f32(0.5f);
+
+    for(; i + 4 <= n_out; i += 4)
+    {
+        float32x4x2_t const lr = vld2q_f32(in + 2 * i);
+
+        vst1q_f32(out + i, vmulq_f32(vaddq_f32(lr.val[0], lr.val[1]), half));
+    }
+#endif //MT_STT_SSE2
+
+    for(; i < n_out; ++i)
+    {
+        out[i] = (in[2 * i] + in[2 * i + 1]) * 0.5f;
+    }
+}
+
+/** Down-mix the given interleaved frames to mono in place.
+ */
+static void downmix(float * const buf, size_t const frames, int const channels)
+{
+    if(channels == 1)
+    {
+        return;
+    }
+    if(channels == 2)
+    {
+        mean_of_pairs(buf, buf, 2 * frames);
+        return;
+    }
+
+    float const scale = 1.0f / (float)channels;
+
+    // The channels of each frame are summed up four at a time (e.g. 5.1 or
+    // 7.1), each frame is read before its mean gets written to a position
+    // that is not after the frame's first sample:
+    //
+    for(size_t i = 0; i < frames; ++i)
+    {
+        float const * const frame = buf + i * channels;
+        int c = 0;
+        float sum = 0.0f;
+
+#if defined(MT_STT_SSE2)
+        if(4 <= channels)
+        {
+            __m128 v_sum = _mm_loadu_ps(frame);
+
+            for(c = 4; c + 4 <= channels; c += 4)
+            {
+                v_sum = _mm_add_ps(v_sum, _mm_loadu_ps(frame + c));
+            }
+            v_sum = _mm_add_ps(v_sum, _mm_movehl_ps(v_sum, v_sum));
+            v_sum = _mm_add_ss(v_sum, _mm_shuffle_ps(v_sum, v_sum, 1));
+            sum = _mm_cvtss_f32(v_sum);
+        }
+#elif defined(__ARM_NEON)
+        if(4 <= channels)
+        {
+            float32x4_t v_sum = vld1q_f32(frame);
+
+            for(c = 4; c + 4 <= channels; c += 4)
+            {
+                v_sum = vaddq_f32(v_sum, vld1q_f32(frame + c));
+            }
+            sum = vgetq_lane_f32(v_sum, 0) + vgetq_lane_f32(v_sum, 1)
+                + vgetq_lane_f32(v_sum, 2) + vgetq_lane_f32(v_sum, 3);
+        }
+#endif //MT_STT_SSE2
+
+        for(; c < channels; ++c)
+        {
+            sum += frame[c];
+        }
+        buf[i] = sum * scale;
+    }
+}
+
+/** Up-sample the given mono audio data by factor 2 via linear interpolation
+ *  (e.g. 8 kHz telephony audio), writing 2 * n_in values to out.
+ */
+static void double_rate(
+    float const * const in, size_t const n_in, float * const out)
+{
+    size_t i = 0;
+
+    // Each input sample is followed by the mean of it and the next one:
+
+#if defined(MT_STT_SSE2)
+    __m128 const half = _mm_set1_ps(0.5f);
+
+    for(; i + 5 <= n_in; i += 4)
+    {
+        __m128 const a = _mm_loadu_ps(in + i);
+        __m128 const b = _mm_loadu_ps(in + i + 1);
+        __m128 const mid = _mm_mul_ps(_mm_add_ps(a, b), half);
+
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(a, mid));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(a, mid));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t const half = vdupq_n_f32(0.5f);
+
+    for(; i + 5 <= n_in; i += 4)
+    {
+        float32x4x2_t v;
+
+        v.val[0] = vld1q_f32(in + i);
+        v.val[1] = vmulq_f32(vaddq_f32(v.val[0], vld1q_f32(in + i + 1)), half);
+        vst2q_f32(out + 2 * i, v);
+    }
+#endif //MT_STT_SSE2
+
+    for(; i < n_in; ++i)
+    {
+        float const a = in[i];
+        float const b = i + 1 < n_in ? in[i + 1] : a;
+
+        out[2 * i] = a;
+        out[2 * i + 1] = a + (b - a) * 0.5f;
+    }
+}
+
+/** Resample the given mono audio data to 16 kHz.
+ *
+ * - Down-sampling uses the mean of the input samples covered by each output
+ *   sample (a simple low-pass filter against aliasing), up-sampling uses
+ *   linear interpolation.
+ */
+static void resample(
+    float const * const in,
+    size_t const n_in,
+    int const sample_rate,
+    std::vector<float> & out_ref)
+{
+    assert(sample_rate != s_whisper_sample_rate);
+
+    size_t const n_out = (size_t)(
+        (unsigned long long)n_in * s_whisper_sample_rate / sample_rate);
+
+    out_ref.resize(n_out);
+    if(n_out == 0)
+    {
+        return;
+    }
+
+    if(sample_rate == 2 * s_whisper_sample_rate) // E.g. 32 kHz.
+    {
+        mean_of_pairs(in, out_ref.data(), 2 * n_out);
+        return;
+    }
+
+    double const step = (double)sample_rate / (double)s_whisper_sample_rate;
+
+    if(s_whisper_sample_rate < sample_rate) // => Down-sampling.
+    {
+        for(size_t j = 0; j < n_out; ++j)
+        {
+            size_t const first = (size_t)((double)j * step);
+            size_t limit = (size_t)((double)(j + 1) * step);
+            float sum = 0.0f;
+
+            if(n_in < limit)
+            {
+                limit = n_in;
+            }
+            for(size_t i = first; i < limit; ++i)
+            {
+                sum += in[i];
+            }
+            out_ref[j] =
+                limit <= first ? in[first] : sum / (float)(limit - first);
+        }
+        return;
+    }
+
+    // Up-sampling:
+
+    if(2 * sample_rate == s_whisper_sample_rate) // E.g. 8 kHz.
+    {
+        double_rate(in, n_in, out_ref.data());
+        return;
+    }
+
+    for(size_t j = 0; j < n_out; ++j)
+    {
+        double const pos = (double)j * step;
+        size_t const i = (size_t)pos;
+        float const frac = (float)(pos - (double)i);
+        float const a = in[i];
+        float const b = i + 1 < n_in ? in[i + 1] : a;
+
+        out_ref[j] = a + (b - a) * frac;
+    }
+}
+
+/** Release the conversion buffers of the calling thread, if they got too
+ *  large (e.g. by a long file), to not keep that memory per thread.
+ */
+static void release_buffers()
+{
+    if(s_max_kept_samples < s_buf.capacity())
+    {
+        std::vector<float>().swap(s_buf);
+    }
+    if(s_max_kept_samples < s_resampled.capacity())
+    {
+        std::vector<float>().swap(s_resampled);
+    }
+}
+
+/** Convert the given PCM audio data to mono, 32-bit float, 16 kHz.
+ *
+ * - The returned pointer is either the given data itself (if it already has
+ *   the format needed) or points into a buffer of the calling thread, which
+ *   stays valid until the next conversion or release_buffers() call by the
+ *   same thread.
+ * - Returns NULL on error.
+ */
+static float const * convert(
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    int * const out_len)
+{
+    *out_len = 0;
+
+    if(pcm_data == nullptr || channels < 1 || sample_rate < 1000
+        || frame_count < 0)
+    {
+        return nullptr;
+    }
+
+    size_t const frames = (size_t)frame_count;
+    size_t const samples = frames * (size_t)channels;
+    float const * mono = nullptr;
+
+    if(sample_format == MT_STT_SAMPLE_FORMAT_F32 && channels == 1)
+    {
+        mono = (float const *)pcm_data; // No conversion needed.
+    }
+    else
+    {
+        s_buf.resize(samples);
+        switch(sample_format)
+        {
+            case MT_STT_SAMPLE_FORMAT_F32:
+            {
+                float const * const in = (float const *)pcm_data;
+
+                if(channels == 2)
+                {
+                    mean_of_pairs(in, s_buf.data(), samples);
+                    break;
+                }
+                s_buf.assign(in, in + samples);
+                downmix(s_buf.data(), frames, channels);
+                break;
+            }
+            case MT_STT_SAMPLE_FORMAT_S16:
+            {
+                convert_s16((int16_t const *)pcm_data, s_buf.data(), samples);
+                downmix(s_buf.data(), frames, channels);
+                break;
+            }
+            case MT_STT_SAMPLE_FORMAT_S32:
+            {
+                convert_s32((int32_t const *)pcm_data, s_buf.data(), samples);
+                downmix(s_buf.data(), frames, channels);
+                break;
+            }
+
+            default:
+            {
+                return nullptr;
+            }
+        }
+        mono = s_buf.data();
+    }
+
+    if(sample_rate == s_whisper_sample_rate)
+    {
+        *out_len = frame_count;
+        return mono;
+    }
+
+    resample(mono, frames, sample_rate, s_resampled);
+    *out_len = (int)s_resampled.size();
+    return s_resampled.data();
+}
+
+/**
+ * - Returns NULL on error.
+ */
+static char* transcribe_pcm(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_frame_indices,
+    int const * const opt_parts_frame_limits,
+    int const opt_parts_length)
+{
+    int audio_data_length = 0;
+    float const * const audio_data_arr = convert(
+        pcm_data,
+        sample_format,
+        channels,
+        sample_rate,
+        frame_count,
+        &audio_data_length);
+
+    if(audio_data_arr == nullptr)
+    {
+        return nullptr;
+    }
+
+    if(opt_parts_length == 0 || sample_rate == s_whisper_sample_rate)
+    {
+        return mt_stt_transcribe_with_params(
+            model,
+            params,
+            audio_data_arr,
+            audio_data_length,
+            opt_out_word_probs,
+            opt_out_word_probs_count,
+            opt_out_parts_ret_val_indices,
+            opt_parts_frame_indices,
+            opt_parts_frame_limits,
+            opt_parts_length);
+    }
+
+    if(opt_parts_frame_indices == nullptr || opt_parts_frame_limits == nullptr
+        || opt_parts_length < 0)
+    {
+        return nullptr;
+    }
+
+    // Convert the parts' frame indices to the 16 kHz sample indices:
+
+    std::vector<int> indices(opt_parts_length);
+    std::vector<int> limits(opt_parts_length);
+
+    for(int i = 0; i < opt_parts_length; ++i)
+    {
+        long long const index = (long long)opt_parts_frame_indices[i]
+            * s_whisper_sample_rate / sample_rate;
+        long long const limit = (long long)opt_parts_frame_limits[i]
+            * s_whisper_sample_rate / sample_rate;
+
+        indices[i] =
+            (int)(index < audio_data_length ? index : audio_data_length);
+        limits[i] =
+            (int)(limit < audio_data_length ? limit : audio_data_length);
+    }
+
+    return mt_stt_transcribe_with_params(
+        model,
+        params,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        indices.data(),
+        limits.data(),
+        opt_parts_length);
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_pcm(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * const opt_out_parts_ret_val_indices,
+    int const * const opt_parts_frame_indices,
+    int const * const opt_parts_frame_limits,
+    int const opt_parts_length)
+{
+    char* const ret_val = transcribe_pcm(
+        model,
+        params,
+        pcm_data,
+        sample_format,
+        channels,
+        sample_rate,
+        frame_count,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        opt_out_parts_ret_val_indices,
+        opt_parts_frame_indices,
+        opt_parts_frame_limits,
+        opt_parts_length);
+
+    release_buffers();
+    return ret_val;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_stream_push_pcm(
+    struct mt_stt_stream * const stream,
+    void const * const pcm_data,
+    enum mt_stt_sample_format const sample_format,
+    int const channels,
+    int const sample_rate,
+    int const frame_count)
+{
+    int audio_data_length = 0;
+    float const * const audio_data_arr = convert(
+        pcm_data,
+        sample_format,
+        channels,
+        sample_rate,
+        frame_count,
+        &audio_data_length);
+
+    if(audio_data_arr == nullptr)
+    {
+        return false;
+    }
+
+    bool const ret_val =
+        mt_stt_stream_push(stream, audio_data_arr, audio_data_length);
+
+    release_buffers();
+    return ret_val;
+}
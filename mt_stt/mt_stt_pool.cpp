@@ -0,0 +1,481 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// The compute thread pool shared by all transcriptions (see
+// mt_stt_thread_pool_configure()).
+//
+// - Each lane is a persistent thread pinned to its own CPUs, Whisper's
+//   computations are run on the lanes, one at a time per lane.
+// - ggml's worker threads are started by the thread calling Whisper (once per
+//   thread with OpenMP, otherwise per computation) and inherit the CPU
+//   affinity of the lane. Whisper does not give access to the ggml backends
+//   of its states, so a ggml threadpool can not be attached to them.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif //_WIN32
+
+struct lane
+{
+    std::vector<int> cpus;
+    int n_threads;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void(int)> const * job; // Set, while a job is to be run.
+    bool done;
+    bool quit;
+};
+
+struct pool
+{
+    std::vector<std::unique_ptr<struct lane>> lanes;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<struct lane *> free_lanes;
+};
+
+static std::mutex s_pool_mutex;
+static std::shared_ptr<struct pool> s_pool; // NULL, if disabled.
+
+/** Parse the given list of CPUs, e.g. "0-3,8,10-11" (as used by Linux).
+ *
+ * - Returns false on error.
+ */
+static bool parse_cpus(char const * const str, std::vector<int> & out_cpus)
+{
+    char const * pos = str;
+
+    out_cpus.clear();
+    while(*pos != '\0' && *pos != '\n')
+    {
+        char * end = nullptr;
+        long const first = strtol(pos, &end, 10);
+        long last = first;
+
+        if(end == pos || first < 0)
+        {
+            return false;
+        }
+        pos = end;
+        if(*pos == '-')
+        {
+            ++pos;
+            last = strtol(pos, &end, 10);
+            if(end == pos || last < first)
+            {
+                return false;
+            }
+            pos = end;
+        }
+        for(long cpu = first; cpu <= last; ++cpu)
+        {
+            out_cpus.push_back((int)cpu);
+        }
+        if(*pos == ',')
+        {
+            ++pos;
+        }
+        else if(*pos != '\0' && *pos != '\n')
+        {
+            return false;
+        }
+    }
+    return !out_cpus.empty();
+}
+
+/** Get the CPUs the process may run on.
+ */
+static void get_process_cpus(std::vector<int> & out_cpus)
+{
+    out_cpus.clear();
+
+#ifdef _WIN32
+    DWORD_PTR process_mask, system_mask;
+
+    if(GetProcessAffinityMask(
+        GetCurrentProcess(), &process_mask, &system_mask))
+    {
+        for(int cpu = 0; cpu < (int)(8 * sizeof process_mask); ++cpu)
+        {
+            if((process_mask >> cpu) & 1)
+            {
+                out_cpus.push_back(cpu);
+            }
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof set, &set) == 0)
+    {
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if(CPU_ISSET(cpu, &set))
+            {
+                out_cpus.push_back(cpu);
+            }
+        }
+    }
+#endif //_WIN32
+
+    if(out_cpus.empty())
+    {
+        int const n = (int)std::thread::hardware_concurrency();
+
+        for(int cpu = 0; cpu < (n < 1 ? 1 : n); ++cpu)
+        {
+            out_cpus.push_back(cpu);
+        }
+    }
+}
+
+/** Get the CPUs of the given NUMA node.
+ *
+ * - Returns false on error (or, if not supported).
+ */
+static bool get_numa_cpus(int const node, std::vector<int> & out_cpus)
+{
+#ifdef _WIN32
+    ULONGLONG mask = 0;
+
+    out_cpus.clear();
+    if(255 < node || !GetNumaNodeProcessorMask((UCHAR)node, &mask))
+    {
+        return false;
+    }
+    for(int cpu = 0; cpu < 64; ++cpu)
+    {
+        if((mask >> cpu) & 1)
+        {
+            out_cpus.push_back(cpu);
+        }
+    }
+    return !out_cpus.empty();
+#elif defined(__linux__)
+    std::string const path =
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    FILE * const file = fopen(path.c_str(), "r");
+    char buf[1024];
+    bool ret_val = false;
+
+    if(file == nullptr)
+    {
+        return false;
+    }
+    if(fgets(buf, sizeof buf, file) != nullptr)
+    {
+        ret_val = parse_cpus(buf, out_cpus);
+    }
+    fclose(file);
+    return ret_val;
+#else //_WIN32
+    (void)node;
+    out_cpus.clear();
+    return false;
+#endif //_WIN32
+}
+
+/** Pin the calling thread to the given CPUs.
+ */
+static void pin(std::vector<int> const & cpus_ref)
+{
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+
+    for(int const cpu : cpus_ref)
+    {
+        if(cpu < (int)(8 * sizeof mask))
+        {
+            mask |= (DWORD_PTR)1 << cpu;
+        }
+    }
+    if(mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN, "Warning: Failed to pin lane thread!\n");
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    for(int const cpu : cpus_ref)
+    {
+        if(cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if(pthread_setaffinity_np(pthread_self(), sizeof set, &set) != 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN, "Warning: Failed to pin lane thread!\n");
+    }
+#else //_WIN32
+    (void)cpus_ref; // Not supported.
+#endif //_WIN32
+}
+
+static void run_lane(struct lane * const lane)
+{
+    pin(lane->cpus);
+
+    std::unique_lock<std::mutex> lock(lane->mutex);
+
+    while(true)
+    {
+        lane->cv.wait(
+            lock, [lane]() { return lane->job != nullptr || lane->quit; });
+        if(lane->job == nullptr)
+        {
+            return; // Quit.
+        }
+
+        std::function<void(int)> const * const job = lane->job;
+
+        lock.unlock();
+        (*job)(lane->n_threads);
+        lock.lock();
+
+        lane->job = nullptr;
+        lane->done = true;
+        lane->cv.notify_all();
+    }
+}
+
+/** Stop the lanes of the given pool and free it (as deleter of s_pool, the
+ *  last transcription using the pool frees it).
+ */
+static void free_pool(struct pool * const p)
+{
+    for(std::unique_ptr<struct lane> const & lane : p->lanes)
+    {
+        {
+            std::lock_guard<std::mutex> const lock(lane->mutex);
+
+            lane->quit = true;
+        }
+        lane->cv.notify_all();
+        lane->thread.join();
+    }
+    delete p;
+}
+
+bool mt_stt_pool_run(
+    struct mt_stt_request * const opt_req,
+    int const n_threads,
+    std::function<void(int)> const & func_ref)
+{
+    std::shared_ptr<struct pool> p;
+
+    {
+        std::lock_guard<std::mutex> const lock(s_pool_mutex);
+
+        p = s_pool;
+    }
+
+    if(!p)
+    {
+        func_ref(n_threads);
+        return true;
+    }
+
+    struct lane * lane = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(p->mutex);
+
+        while(p->free_lanes.empty())
+        {
+            if(opt_req != nullptr && mt_stt_is_aborted(opt_req))
+            {
+                return false;
+            }
+            p->cv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        lane = p->free_lanes.back();
+        p->free_lanes.pop_back();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(lane->mutex);
+
+        lane->job = &func_ref;
+        lane->done = false;
+        lane->cv.notify_all();
+        lane->cv.wait(lock, [lane]() { return lane->done; });
+    }
+
+    {
+        std::lock_guard<std::mutex> const lock(p->mutex);
+
+        p->free_lanes.push_back(lane);
+    }
+    p->cv.notify_one();
+    return true;
+}
+
+/**
+ * - Returns false on error.
+ */
+static bool get_cpus(
+    char const * const opt_cpus,
+    int const numa_node,
+    std::vector<int> & out_cpus)
+{
+    std::vector<int> process_cpus, wanted_cpus, node_cpus;
+
+    get_process_cpus(process_cpus);
+
+    if(opt_cpus != nullptr && !parse_cpus(opt_cpus, wanted_cpus))
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Invalid list of CPUs \"%s\"!\n",
+            opt_cpus);
+        return false;
+    }
+    if(0 <= numa_node && !get_numa_cpus(numa_node, node_cpus))
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Failed to get CPUs of NUMA node %d!\n",
+            numa_node);
+        return false;
+    }
+
+    auto const contains = [](std::vector<int> const & v, int const cpu)
+        {
+            for(int const c : v)
+            {
+                if(c == cpu)
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+    out_cpus.clear();
+    for(int const cpu : process_cpus)
+    {
+        if((opt_cpus == nullptr || contains(wanted_cpus, cpu))
+            && (numa_node < 0 || contains(node_cpus, cpu)))
+        {
+            out_cpus.push_back(cpu);
+        }
+    }
+    if(out_cpus.empty())
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: No CPUs left for thread pool!\n");
+        return false;
+    }
+    return true;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_thread_pool_configure(
+    int const n_lanes,
+    int const threads_per_lane,
+    char const * const opt_cpus,
+    int const numa_node)
+{
+    std::shared_ptr<struct pool> p;
+    bool ret_val = true;
+
+    mt_stt_open_log();
+
+    if(0 < n_lanes)
+    {
+        std::vector<int> cpus;
+
+        ret_val = get_cpus(opt_cpus, numa_node, cpus);
+        if(ret_val)
+        {
+            int const n_cpus = (int)cpus.size();
+            int n_threads = threads_per_lane;
+
+            if(n_threads <= 0)
+            {
+                n_threads = n_cpus / n_lanes;
+                if(n_threads < 1)
+                {
+                    n_threads = 1;
+                }
+            }
+            if(n_cpus < n_lanes * n_threads)
+            {
+                mt_stt_log_printf(
+                    MT_STT_LOG_LEVEL_WARN,
+                    "Warning: %d lanes with %d threads each oversubscribe %d"
+                        " CPUs!\n",
+                    n_lanes,
+                    n_threads,
+                    n_cpus);
+            }
+
+            p = std::shared_ptr<struct pool>(new pool, free_pool);
+            for(int i = 0; i < n_lanes; ++i)
+            {
+                std::unique_ptr<struct lane> lane(new struct lane);
+                std::string cpu_names;
+
+                lane->n_threads = n_threads;
+                lane->job = nullptr;
+                lane->done = false;
+                lane->quit = false;
+                for(int t = 0; t < n_threads; ++t)
+                {
+                    lane->cpus.push_back(cpus[(i * n_threads + t) % n_cpus]);
+                    cpu_names += ' ' + std::to_string(lane->cpus.back());
+                }
+                mt_stt_log_printf(
+                    MT_STT_LOG_LEVEL_INFO,
+                    "Thread pool lane %d: %d threads (CPUs:%s)\n",
+                    i,
+                    n_threads,
+                    cpu_names.c_str());
+
+                lane->thread = std::thread(run_lane, lane.get());
+                p->free_lanes.push_back(lane.get());
+                p->lanes.push_back(std::move(lane));
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> const lock(s_pool_mutex);
+
+        s_pool.swap(p);
+    }
+    p.reset(); // Frees the old pool, if not used by a transcription.
+
+    mt_stt_close_log();
+    return ret_val;
+}
@@ -0,0 +1,261 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Tokens of initial prompts: Cached per model (keyed by prompt text),
+// registered once per model or given directly by the caller.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Max. count of prompt texts whose tokens are cached per model (the cache is
+// cleared, if full):
+//
+static size_t const s_max_cached_prompts = 64;
+
+/** Tokenize the given text.
+ *
+ * - Returns false on error.
+ */
+static bool tokenize(
+    struct whisper_context * const ctx,
+    char const * const text,
+    std::vector<whisper_token> & out_tokens)
+{
+    out_tokens.resize(1024);
+
+    int n = whisper_tokenize(
+        ctx, text, out_tokens.data(), static_cast<int>(out_tokens.size()));
+
+    if(n < 0)
+    {
+        out_tokens.resize(-n);
+
+        n = whisper_tokenize(
+            ctx, text, out_tokens.data(), static_cast<int>(out_tokens.size()));
+    }
+    if(n < 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Failed to tokenize prompt!\n");
+        return false;
+    }
+    out_tokens.resize(n);
+    return true;
+}
+
+/** Check, if the given tokens are text tokens and not too many to be used as
+ *  initial prompt [see whisper_full_with_state()].
+ */
+static bool is_valid(
+    struct whisper_context * const ctx,
+    whisper_token const * const tokens,
+    int const n_tokens)
+{
+    int const max_initial_prompt_tokens = whisper_n_text_ctx(ctx) / 2;
+
+#ifndef NDEBUG
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_DEBUG,
+        "max_initial_prompt_tokens: %d; n_needed: %d\n",
+        max_initial_prompt_tokens,
+        n_tokens);
+#endif //NDEBUG
+
+    if(max_initial_prompt_tokens < n_tokens)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Initial prompt is too long (%d tokens, max. is %d tokens)!\n",
+            n_tokens,
+            max_initial_prompt_tokens);
+        return false;
+    }
+
+    whisper_token const tok_eot = whisper_token_eot(ctx);
+
+    for(int i = 0; i < n_tokens; ++i)
+    {
+        if(tokens[i] < 0 || tok_eot <= tokens[i])
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Invalid prompt token %d at index %d!\n",
+                (int)tokens[i],
+                i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Get the tokens of the given prompt text from the model's cache or
+ *  tokenize the text and add the tokens to the cache.
+ *
+ * - Returns false on error.
+ */
+static bool get_cached(
+    struct mt_stt_model * const model,
+    char const * const text,
+    std::vector<whisper_token> & out_tokens)
+{
+    {
+        std::lock_guard<std::mutex> const lock(model->prompts_mutex);
+        auto const it = model->prompts_cache.find(text);
+
+        if(it != model->prompts_cache.end())
+        {
+            out_tokens = it->second;
+            return true;
+        }
+    }
+
+    // Tokenize without holding the lock (another thread may do the same for
+    // the same text, at the same time, which does no harm):
+
+    if(!tokenize(model->ctx, text, out_tokens))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> const lock(model->prompts_mutex);
+
+    if(s_max_cached_prompts <= model->prompts_cache.size())
+    {
+        model->prompts_cache.clear();
+    }
+    model->prompts_cache.emplace(text, out_tokens);
+    return true;
+}
+
+bool mt_stt_get_prompt_tokens(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const & mt_params_ref,
+    std::vector<whisper_token> & out_tokens)
+{
+    out_tokens.clear();
+
+    if(mt_params_ref.prompt_tokens != nullptr)
+    {
+        if(mt_params_ref.prompt_n_tokens < 0)
+        {
+            return false;
+        }
+        out_tokens.assign(
+            mt_params_ref.prompt_tokens,
+            mt_params_ref.prompt_tokens + mt_params_ref.prompt_n_tokens);
+    }
+    else if(0 <= mt_params_ref.prompt_id)
+    {
+        std::lock_guard<std::mutex> const lock(model->prompts_mutex);
+        auto const it = model->registered_prompts.find(mt_params_ref.prompt_id);
+
+        if(it == model->registered_prompts.end())
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Prompt with ID %d is not registered!\n",
+                mt_params_ref.prompt_id);
+            return false;
+        }
+        out_tokens = it->second;
+        return true; // Checked on registration.
+    }
+    else if(mt_params_ref.initial_prompt != nullptr
+        && 0 < strlen(mt_params_ref.initial_prompt))
+    {
+        if(!get_cached(model, mt_params_ref.initial_prompt, out_tokens))
+        {
+            return false;
+        }
+    }
+    return is_valid(
+        model->ctx, out_tokens.data(), static_cast<int>(out_tokens.size()));
+}
+
+/** Register the given tokens as prompt of the given model.
+ *
+ * - Returns the ID of the prompt or -1 on error.
+ */
+static int register_prompt(
+    struct mt_stt_model * const model, std::vector<whisper_token> && tokens)
+{
+    if(!is_valid(model->ctx, tokens.data(), static_cast<int>(tokens.size())))
+    {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> const lock(model->prompts_mutex);
+    int const ret_val = model->next_prompt_id;
+
+    assert(0 <= ret_val);
+
+    ++model->next_prompt_id;
+    model->registered_prompts.emplace(ret_val, std::move(tokens));
+    return ret_val;
+}
+
+MT_EXPORT_STT_API int __stdcall mt_stt_prompt_register(
+    struct mt_stt_model * const model, char const * const prompt)
+{
+    if(model == nullptr || prompt == nullptr)
+    {
+        return -1;
+    }
+
+    std::vector<whisper_token> tokens;
+    int ret_val = -1;
+
+    mt_stt_open_log();
+    if(tokenize(model->ctx, prompt, tokens))
+    {
+        ret_val = register_prompt(model, std::move(tokens));
+    }
+    mt_stt_close_log();
+    return ret_val;
+}
+
+MT_EXPORT_STT_API int __stdcall mt_stt_prompt_register_tokens(
+    struct mt_stt_model * const model,
+    int const * const tokens,
+    int const n_tokens)
+{
+    if(model == nullptr || (tokens == nullptr && n_tokens != 0)
+        || n_tokens < 0)
+    {
+        return -1;
+    }
+
+    int ret_val = -1;
+
+    mt_stt_open_log();
+    ret_val = register_prompt(
+        model, std::vector<whisper_token>(tokens, tokens + n_tokens));
+    mt_stt_close_log();
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_prompt_unregister(
+    struct mt_stt_model * const model, int const prompt_id)
+{
+    if(model == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> const lock(model->prompts_mutex);
+
+    model->registered_prompts.erase(prompt_id);
+}
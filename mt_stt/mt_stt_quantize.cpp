@@ -0,0 +1,684 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Quantizing a Whisper model (f32 or f16) in memory, the same way as
+// Whisper.cpp's "quantize" example does it with model files, with an optional
+// cache of the results on disk.
+//
+// ggml model file format of Whisper:
+//
+// - Magic number, hyperparameters (incl. ftype), mel filters and vocabulary.
+// - Tensors, each with its count of dimensions, length of its name, type,
+//   count of elements per dimension, name and data (without any alignment).
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint32_t const s_magic = 0x67676d6c; // "ggml"
+
+// Offset of the ftype field (after magic and ten other hyperparameters):
+//
+static size_t const s_ftype_offset = 4 + 10 * 4;
+
+// These 2-D tensors are not quantized (as in Whisper.cpp's quantize example):
+//
+static char const * const s_skip[] = {
+    "encoder.conv1.bias",
+    "encoder.conv2.bias",
+    "encoder.positional_embedding",
+    "decoder.positional_embedding"
+};
+
+struct reader
+{
+    unsigned char const * pos;
+    unsigned char const * end;
+};
+
+/**
+ * - Returns false, if there are not enough bytes left.
+ */
+static bool get_bytes(
+    struct reader & reader_ref, void * const out_bytes, size_t const len)
+{
+    if((size_t)(reader_ref.end - reader_ref.pos) < len)
+    {
+        return false;
+    }
+    memcpy(out_bytes, reader_ref.pos, len);
+    reader_ref.pos += len;
+    return true;
+}
+
+template<typename T> static bool get(struct reader & reader_ref, T & out_val)
+{
+    return get_bytes(reader_ref, &out_val, sizeof out_val);
+}
+
+/**
+ * - Returns false, if there are not enough bytes left.
+ */
+static bool skip(struct reader & reader_ref, size_t const len)
+{
+    if((size_t)(reader_ref.end - reader_ref.pos) < len)
+    {
+        return false;
+    }
+    reader_ref.pos += len;
+    return true;
+}
+
+static enum ggml_type get_ggml_type(enum mt_stt_quant_type const type)
+{
+    switch(type)
+    {
+        case MT_STT_QUANT_Q5_1:
+            return GGML_TYPE_Q5_1;
+        case MT_STT_QUANT_Q4_0:
+            return GGML_TYPE_Q4_0;
+
+        case MT_STT_QUANT_Q8_0: // (falls through)
+        default:
+            return GGML_TYPE_Q8_0;
+    }
+}
+
+/** Get the ftype hyperparameter of a model quantized to the given type.
+ */
+static int32_t get_ftype(enum mt_stt_quant_type const type)
+{
+    enum ggml_ftype ftype;
+
+    switch(type)
+    {
+        case MT_STT_QUANT_Q5_1:
+            ftype = GGML_FTYPE_MOSTLY_Q5_1;
+            break;
+        case MT_STT_QUANT_Q4_0:
+            ftype = GGML_FTYPE_MOSTLY_Q4_0;
+            break;
+
+        case MT_STT_QUANT_Q8_0: // (falls through)
+        default:
+            ftype = GGML_FTYPE_MOSTLY_Q8_0;
+            break;
+    }
+    return GGML_QNT_VERSION * GGML_QNT_VERSION_FACTOR + (int32_t)ftype;
+}
+
+static char const * get_type_name(enum mt_stt_quant_type const type)
+{
+    switch(type)
+    {
+        case MT_STT_QUANT_Q5_1:
+            return "q5_1";
+        case MT_STT_QUANT_Q4_0:
+            return "q4_0";
+
+        case MT_STT_QUANT_Q8_0: // (falls through)
+        default:
+            return "q8_0";
+    }
+}
+
+static bool is_skipped(std::string const & name_ref)
+{
+    for(char const * const name : s_skip)
+    {
+        if(name_ref == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Quantize the given rows of the given tensor data (f32 or f16) by the
+ *  given count of threads.
+ *
+ * - src_f32 and work are buffers reused for all tensors.
+ * - Returns the count of bytes written to dst.
+ */
+static size_t quantize_tensor(
+    enum ggml_type const type,
+    enum ggml_type const src_type,
+    unsigned char const * const src,
+    int64_t const n_rows,
+    int64_t const n_per_row,
+    int const n_threads,
+    std::vector<float> & src_f32,
+    std::vector<char> & work,
+    unsigned char * const dst)
+{
+    size_t const row_size = ggml_row_size(type, n_per_row);
+    int64_t const workers = n_rows < n_threads ? n_rows : n_threads;
+    std::vector<std::thread> threads;
+
+    src_f32.resize((size_t)(n_rows * n_per_row));
+    work.resize((size_t)n_rows * row_size);
+
+    auto const run = [&](int64_t const w)
+        {
+            int64_t const first = n_rows * w / workers;
+            int64_t const limit = n_rows * (w + 1) / workers;
+            float * const f32 = src_f32.data() + first * n_per_row;
+            size_t const n = (size_t)((limit - first) * n_per_row);
+
+            // Tensor data in the model is not aligned, so it is copied:
+            //
+            if(src_type == GGML_TYPE_F32)
+            {
+                memcpy(f32, src + first * n_per_row * 4, n * 4);
+            }
+            else
+            {
+                std::vector<ggml_fp16_t> f16((size_t)n_per_row);
+
+                for(int64_t r = first; r < limit; ++r)
+                {
+                    memcpy(
+                        f16.data(),
+                        src + r * n_per_row * 2,
+                        (size_t)n_per_row * 2);
+                    ggml_fp16_to_fp32_row(
+                        f16.data(),
+                        src_f32.data() + r * n_per_row,
+                        n_per_row);
+                }
+            }
+
+            ggml_quantize_chunk(
+                type,
+                src_f32.data(),
+                work.data(),
+                first * n_per_row,
+                limit - first,
+                n_per_row,
+                nullptr);
+        };
+
+    for(int64_t w = 1; w < workers; ++w)
+    {
+        threads.emplace_back(run, w);
+    }
+    run(0); // The calling thread is the first worker.
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    memcpy(dst, work.data(), work.size());
+    return work.size();
+}
+
+/** Convert the given f32 tensor data to f16.
+ *
+ * - Returns the count of bytes written to dst.
+ */
+static size_t convert_to_f16(
+    unsigned char const * const src,
+    int64_t const n,
+    std::vector<float> & src_f32,
+    unsigned char * const dst)
+{
+    std::vector<ggml_fp16_t> f16((size_t)n);
+
+    src_f32.resize((size_t)n);
+    memcpy(src_f32.data(), src, (size_t)n * 4);
+    ggml_fp32_to_fp16_row(src_f32.data(), f16.data(), n);
+    memcpy(dst, f16.data(), (size_t)n * 2);
+    return (size_t)n * 2;
+}
+
+/** Quantize the given model data into the given buffer (which needs to be at
+ *  least as large as the model data, the result is never larger).
+ *
+ * - Returns the length of the result or 0 on error.
+ */
+static size_t quantize(
+    unsigned char const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type,
+    int const n_threads,
+    unsigned char * const out_data)
+{
+    struct reader r = { model_data, model_data + model_data_len };
+    uint32_t magic;
+    int32_t hparams[11]; // n_vocab, n_audio_ctx, ..., n_mels, ftype.
+
+    if(!get(r, magic) || magic != s_magic)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Model data has no ggml magic!\n");
+        return 0;
+    }
+    if(!get_bytes(r, hparams, sizeof hparams))
+    {
+        return 0;
+    }
+
+    int32_t const ftype = hparams[10];
+
+    if(ftype != GGML_FTYPE_ALL_F32 && ftype != GGML_FTYPE_MOSTLY_F16)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR,
+            "Error: Model data is not f32 or f16 (ftype %d)!\n",
+            (int)ftype);
+        return 0;
+    }
+
+    // Mel filters:
+    //
+    int32_t n_mel, n_fft;
+
+    if(!get(r, n_mel) || !get(r, n_fft) || n_mel < 0 || n_fft < 0
+        || !skip(r, (size_t)n_mel * (size_t)n_fft * 4))
+    {
+        return 0;
+    }
+
+    // Vocabulary:
+    //
+    int32_t n_vocab;
+
+    if(!get(r, n_vocab) || n_vocab < 0)
+    {
+        return 0;
+    }
+    for(int32_t i = 0; i < n_vocab; ++i)
+    {
+        uint32_t len;
+
+        if(!get(r, len) || !skip(r, len))
+        {
+            return 0;
+        }
+    }
+
+    // Everything before the tensors is copied as it is (but the ftype):
+    //
+    size_t out_len = (size_t)(r.pos - model_data);
+    int32_t const out_ftype = get_ftype(type);
+
+    memcpy(out_data, model_data, out_len);
+    memcpy(out_data + s_ftype_offset, &out_ftype, sizeof out_ftype);
+
+    enum ggml_type const qtype = get_ggml_type(type);
+    int64_t const blck_size = ggml_blck_size(qtype);
+    std::vector<float> src_f32;
+    std::vector<char> work;
+    int tensors = 0, quantized = 0;
+
+    while(r.pos < r.end)
+    {
+        int32_t n_dims, name_len, ttype;
+        int32_t ne[4] = { 1, 1, 1, 1 };
+        std::string name;
+
+        if(!get(r, n_dims) || !get(r, name_len) || !get(r, ttype)
+            || n_dims < 1 || 4 < n_dims || name_len < 0
+            || (ttype != GGML_TYPE_F32 && ttype != GGML_TYPE_F16)
+            || !get_bytes(r, ne, (size_t)n_dims * sizeof *ne)
+            || (size_t)(r.end - r.pos) < (size_t)name_len)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Invalid tensor header (tensor %d)!\n",
+                tensors);
+            return 0;
+        }
+        name.assign((char const *)r.pos, (size_t)name_len);
+        r.pos += name_len;
+
+        size_t const bpe = ttype == GGML_TYPE_F32 ? 4 : 2;
+        size_t const left = (size_t)(r.end - r.pos) / bpe;
+        int64_t n = 1;
+        bool complete = true;
+
+        for(int i = 0; i < n_dims && complete; ++i)
+        {
+            complete = 0 <= ne[i] && (uint64_t)n * (uint64_t)ne[i] <= left;
+            n *= complete ? ne[i] : 1;
+        }
+
+        unsigned char const * const src = r.pos;
+        size_t const src_len = (size_t)n * bpe;
+
+        if(!complete || !skip(r, src_len))
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Data of tensor \"%s\" is incomplete!\n",
+                name.c_str());
+            return 0;
+        }
+
+        // Same choice as Whisper.cpp's quantize example, all 2-D weights are
+        // quantized. The convolution weights are expected to be f16 by
+        // Whisper for quantized models:
+        //
+        bool const do_quantize = n_dims == 2 && !is_skipped(name);
+        bool const do_f16 = !do_quantize && 3 <= n_dims
+            && ttype == GGML_TYPE_F32;
+        int32_t const out_ttype = do_quantize
+            ? (int32_t)qtype
+            : do_f16 ? (int32_t)GGML_TYPE_F16 : ttype;
+
+        if(do_quantize && ne[0] % blck_size != 0)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_ERROR,
+                "Error: Row size of tensor \"%s\" (%d) is not a multiple"
+                    " of %d!\n",
+                name.c_str(),
+                (int)ne[0],
+                (int)blck_size);
+            return 0;
+        }
+
+        memcpy(out_data + out_len, &n_dims, sizeof n_dims);
+        out_len += sizeof n_dims;
+        memcpy(out_data + out_len, &name_len, sizeof name_len);
+        out_len += sizeof name_len;
+        memcpy(out_data + out_len, &out_ttype, sizeof out_ttype);
+        out_len += sizeof out_ttype;
+        memcpy(out_data + out_len, ne, (size_t)n_dims * sizeof *ne);
+        out_len += (size_t)n_dims * sizeof *ne;
+        memcpy(out_data + out_len, name.data(), (size_t)name_len);
+        out_len += (size_t)name_len;
+
+        if(do_quantize)
+        {
+            out_len += quantize_tensor(
+                qtype,
+                (enum ggml_type)ttype,
+                src,
+                ne[1],
+                ne[0],
+                n_threads,
+                src_f32,
+                work,
+                out_data + out_len);
+            ++quantized;
+        }
+        else if(do_f16)
+        {
+            out_len += convert_to_f16(src, n, src_f32, out_data + out_len);
+        }
+        else
+        {
+            memcpy(out_data + out_len, src, src_len);
+            out_len += src_len;
+        }
+        ++tensors;
+    }
+
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_INFO,
+        "Quantized %d of %d tensors to %s (%zu MB to %zu MB).\n",
+        quantized,
+        tensors,
+        get_type_name(type),
+        model_data_len / (1024 * 1024),
+        out_len / (1024 * 1024));
+    return out_len;
+}
+
+/** Get the path of the cache file for the given model data and type.
+ */
+static std::string get_cache_path(
+    char const * const cache_dir,
+    void const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type)
+{
+    char name[64];
+    std::string ret_val(cache_dir);
+
+    snprintf(
+        name,
+        sizeof name,
+        "mt_stt_%016" PRIx64 "_%s.bin",
+        mt_stt_get_hash(model_data, model_data_len),
+        get_type_name(type));
+
+    if(!ret_val.empty() && ret_val.back() != '/' && ret_val.back() != '\\')
+    {
+        ret_val.push_back('/');
+    }
+    ret_val.append(name);
+    return ret_val;
+}
+
+/** Read the cached model of the given type from the given file.
+ *
+ * - Caller takes ownership of return value (free via mt_stt_free()).
+ * - Returns NULL, if not found or invalid.
+ */
+static void * read_cache(
+    std::string const & path_ref,
+    enum mt_stt_quant_type const type,
+    size_t * const out_len)
+{
+    FILE * const file = fopen(path_ref.c_str(), "rb");
+
+    if(file == nullptr)
+    {
+        return nullptr;
+    }
+
+    void * ret_val = nullptr;
+    long len = -1;
+
+    if(fseek(file, 0, SEEK_END) == 0)
+    {
+        len = ftell(file);
+    }
+    if((long)(s_ftype_offset + 4) <= len && fseek(file, 0, SEEK_SET) == 0)
+    {
+        ret_val = malloc((size_t)len);
+        if(ret_val != nullptr
+            && fread(ret_val, 1, (size_t)len, file) != (size_t)len)
+        {
+            free(ret_val);
+            ret_val = nullptr;
+        }
+    }
+    fclose(file);
+
+    if(ret_val == nullptr)
+    {
+        return nullptr;
+    }
+
+    // Must at least be a model quantized to the expected type:
+    //
+    uint32_t magic;
+    int32_t ftype;
+
+    memcpy(&magic, ret_val, sizeof magic);
+    memcpy(&ftype, (char const *)ret_val + s_ftype_offset, sizeof ftype);
+    if(magic != s_magic || ftype != get_ftype(type))
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_WARN,
+            "Warning: Ignoring invalid cache file \"%s\"!\n",
+            path_ref.c_str());
+        free(ret_val);
+        return nullptr;
+    }
+
+    *out_len = (size_t)len;
+    return ret_val;
+}
+
+/** Write the given model data to the given cache file.
+ *
+ * - Writes to a temporary file first and renames it, so other processes never
+ *   read a partially written file.
+ * - Never fails, problems just skip caching (with a warning).
+ */
+static void write_cache(
+    std::string const & path_ref, void const * const data, size_t const len)
+{
+    std::string const tmp_path = path_ref + ".tmp"
+        + std::to_string((unsigned long long)(uintptr_t)data)
+        + std::to_string(
+            (long long)std::chrono::steady_clock::now()
+                .time_since_epoch().count());
+    FILE * const file = fopen(tmp_path.c_str(), "wb");
+    bool written = false;
+
+    if(file != nullptr)
+    {
+        written = fwrite(data, 1, len, file) == len;
+        written = fclose(file) == 0 && written;
+    }
+    if(written && rename(tmp_path.c_str(), path_ref.c_str()) == 0)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_INFO,
+            "Stored quantized model in \"%s\".\n",
+            path_ref.c_str());
+        return;
+    }
+
+    // (may already exist, if stored by someone else at the same time)
+    //
+    remove(tmp_path.c_str());
+    mt_stt_log_printf(
+        MT_STT_LOG_LEVEL_WARN,
+        "Warning: Failed to store quantized model in \"%s\"!\n",
+        path_ref.c_str());
+}
+
+MT_EXPORT_STT_API void * __stdcall mt_stt_model_quantize(
+    void const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type,
+    char const * const opt_cache_dir,
+    int const n_threads,
+    size_t * const out_len)
+{
+    if(model_data == nullptr || model_data_len == 0 || out_len == nullptr
+        || type < MT_STT_QUANT_Q8_0 || MT_STT_QUANT_Q4_0 < type)
+    {
+        return nullptr;
+    }
+
+    mt_stt_open_log();
+
+    std::string cache_path;
+
+    if(opt_cache_dir != nullptr)
+    {
+        cache_path = get_cache_path(
+            opt_cache_dir, model_data, model_data_len, type);
+
+        void * const cached = read_cache(cache_path, type, out_len);
+
+        if(cached != nullptr)
+        {
+            mt_stt_log_printf(
+                MT_STT_LOG_LEVEL_INFO,
+                "Read quantized model from \"%s\".\n",
+                cache_path.c_str());
+            mt_stt_close_log();
+            return cached;
+        }
+    }
+
+    unsigned char * ret_val = (unsigned char *)malloc(model_data_len);
+
+    if(ret_val == nullptr)
+    {
+        mt_stt_close_log();
+        return nullptr;
+    }
+
+    int threads = n_threads;
+
+    if(threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency();
+        if(threads <= 0)
+        {
+            threads = 1;
+        }
+    }
+
+    size_t const len = quantize(
+        (unsigned char const *)model_data,
+        model_data_len,
+        type,
+        threads,
+        ret_val);
+
+    if(len == 0)
+    {
+        free(ret_val);
+        mt_stt_close_log();
+        return nullptr;
+    }
+
+    // The result is smaller than the source, give back the rest:
+    //
+    unsigned char * const shrunk = (unsigned char *)realloc(ret_val, len);
+
+    if(shrunk != nullptr)
+    {
+        ret_val = shrunk;
+    }
+
+    if(opt_cache_dir != nullptr)
+    {
+        write_cache(cache_path, ret_val, len);
+    }
+
+    mt_stt_close_log();
+
+    *out_len = len;
+    return ret_val;
+}
+
+MT_EXPORT_STT_API struct mt_stt_model * __stdcall mt_stt_model_load_quantized(
+    bool const use_gpu,
+    void const * const model_data,
+    size_t const model_data_len,
+    enum mt_stt_quant_type const type,
+    char const * const opt_cache_dir,
+    int const n_threads)
+{
+    size_t len = 0;
+    void * const data = mt_stt_model_quantize(
+        model_data, model_data_len, type, opt_cache_dir, n_threads, &len);
+
+    if(data == nullptr)
+    {
+        return nullptr;
+    }
+
+    struct mt_stt_model * const ret_val =
+        mt_stt_model_load_from_data(use_gpu, data, len);
+
+    free(data);
+    return ret_val;
+}
@@ -0,0 +1,284 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Structured results (segments, words and tokens with timestamps and
+// probabilities), held by one single allocation.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+//
+static int const s_samples_per_ms = 16;
+
+static size_t get_aligned(size_t const offset)
+{
+    size_t const alignment = alignof(std::max_align_t);
+
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/** Copy the given text with terminating zero to the given position and move
+ *  the position behind it.
+ */
+static char const * copy_text(
+    char * * const pos, char const * const text, size_t const len)
+{
+    char * const ret_val = *pos;
+
+    memcpy(ret_val, text, len);
+    ret_val[len] = '\0';
+    *pos += len + 1;
+    return ret_val;
+}
+
+/** Convert the given Whisper timestamp (10 ms units, relative to the part) to
+ *  milliseconds relative to the beginning of the audio data.
+ */
+static long long get_ms(
+    int64_t const t, long long const part_ms, long long const part_end_ms)
+{
+    long long const ret_val = part_ms + (long long)t * 10LL;
+
+    // Whisper may give timestamps behind the end of padded audio data:
+    //
+    return ret_val < part_end_ms ? ret_val : part_end_ms;
+}
+
+/** Create the structured result from the results of the parts.
+ *
+ * - Returns NULL on error.
+ */
+static struct mt_stt_result * create_result(
+    std::vector<struct mt_stt_part_result> const & results_ref,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits)
+{
+    size_t text_len = 0;
+    size_t n_segments = 0;
+    size_t n_tokens = 0;
+
+    for(struct mt_stt_part_result const & result_ref : results_ref)
+    {
+        text_len += result_ref.text.length();
+        n_segments += result_ref.segments.size();
+        n_tokens += result_ref.tokens.size();
+    }
+
+    // There are never more words than tokens and the texts of all segments,
+    // words and tokens are never longer than the whole text (each), so the
+    // size is known before filling everything in one pass:
+    //
+    size_t const n_words_max = n_tokens;
+    size_t const segments_offset = get_aligned(sizeof(struct mt_stt_result));
+    size_t const words_offset = get_aligned(
+        segments_offset + n_segments * sizeof(struct mt_stt_segment));
+    size_t const tokens_offset = get_aligned(
+        words_offset + n_words_max * sizeof(struct mt_stt_word));
+    size_t const chars_offset =
+        tokens_offset + n_tokens * sizeof(struct mt_stt_token);
+    size_t const size = chars_offset
+        + 4 * text_len + 1 + n_segments + n_words_max + n_tokens;
+    unsigned char * const mem = (unsigned char *)malloc(size);
+
+    if(mem == nullptr)
+    {
+        return nullptr; // Must not get here.
+    }
+
+    struct mt_stt_result * const ret_val = (struct mt_stt_result *)mem;
+    struct mt_stt_segment * const segments = n_segments == 0
+        ? nullptr : (struct mt_stt_segment *)(mem + segments_offset);
+    struct mt_stt_word * const words = n_words_max == 0
+        ? nullptr : (struct mt_stt_word *)(mem + words_offset);
+    struct mt_stt_token * const tokens = n_tokens == 0
+        ? nullptr : (struct mt_stt_token *)(mem + tokens_offset);
+    char * pos = (char *)(mem + chars_offset);
+    int segment_count = 0;
+    int word_count = 0;
+    int token_count = 0;
+
+    // The whole text:
+
+    ret_val->text = pos;
+    for(struct mt_stt_part_result const & result_ref : results_ref)
+    {
+        memcpy(pos, result_ref.text.data(), result_ref.text.length());
+        pos += result_ref.text.length();
+    }
+    *pos = '\0';
+    ++pos;
+
+    for(size_t p = 0; p < results_ref.size(); ++p)
+    {
+        struct mt_stt_part_result const & result_ref = results_ref[p];
+        char const * const text = result_ref.text.data();
+        long long const part_ms = opt_parts_audio_data_indices == nullptr
+            ? 0 : opt_parts_audio_data_indices[p] / s_samples_per_ms;
+        long long const part_end_ms = (opt_parts_audio_data_limits == nullptr
+            ? audio_data_length
+            : opt_parts_audio_data_limits[p]) / s_samples_per_ms;
+
+        for(struct mt_stt_part_segment const & seg_ref : result_ref.segments)
+        {
+            struct mt_stt_segment * const segment = segments + segment_count;
+            struct mt_stt_word * word = nullptr;
+            size_t word_text_index = 0;
+            size_t seg_text_index = 0;
+            size_t seg_text_limit = 0;
+
+            ++segment_count;
+
+            segment->t0_ms = get_ms(seg_ref.t0, part_ms, part_end_ms);
+            segment->t1_ms = get_ms(seg_ref.t1, part_ms, part_end_ms);
+            segment->part_index = (int)p;
+            segment->degraded = result_ref.degraded;
+            segment->word_index = word_count;
+            segment->token_index = token_count;
+            segment->token_count = seg_ref.token_count;
+
+            for(int j = 0; j < seg_ref.token_count; ++j)
+            {
+                struct mt_stt_part_token const & tok_ref =
+                    result_ref.tokens[seg_ref.token_index + j];
+                struct mt_stt_token * const token = tokens + token_count;
+                char const * const tok_text = text + tok_ref.text_index;
+                size_t const tok_limit =
+                    tok_ref.text_index + tok_ref.text_length;
+
+                token->text = copy_text(
+                    &pos, tok_text, tok_ref.text_length);
+                token->id = tok_ref.id;
+                token->p = tok_ref.p;
+                token->t0_ms = get_ms(tok_ref.t0, part_ms, part_end_ms);
+                token->t1_ms = get_ms(tok_ref.t1, part_ms, part_end_ms);
+
+                if(j == 0)
+                {
+                    seg_text_index = tok_ref.text_index;
+                }
+                seg_text_limit = tok_limit;
+
+                if(word == nullptr
+                    || std::isspace(static_cast<unsigned char>(tok_text[0])))
+                {
+                    if(word != nullptr) // => Finish the last word.
+                    {
+                        word->p_mean /= (float)word->token_count;
+                        word->text = copy_text(
+                            &pos,
+                            text + word_text_index,
+                            tok_ref.text_index - word_text_index);
+                    }
+
+                    word = words + word_count;
+                    ++word_count;
+
+                    word->t0_ms = token->t0_ms;
+                    word->p_first = token->p;
+                    word->p_min = token->p;
+                    word->p_mean = 0.0f; // Sum, until finished.
+                    word->token_index = token_count;
+                    word->token_count = 0;
+
+                    word_text_index = tok_ref.text_index;
+                    while(word_text_index < tok_limit
+                        && std::isspace(
+                            static_cast<unsigned char>(
+                                text[word_text_index])))
+                    {
+                        ++word_text_index;
+                    }
+                }
+
+                word->t1_ms = token->t1_ms;
+                if(token->p < word->p_min)
+                {
+                    word->p_min = token->p;
+                }
+                word->p_mean += token->p;
+                ++word->token_count;
+
+                ++token_count;
+            }
+
+            if(word != nullptr) // => Finish the last word of the segment.
+            {
+                word->p_mean /= (float)word->token_count;
+                word->text = copy_text(
+                    &pos,
+                    text + word_text_index,
+                    seg_text_limit - word_text_index);
+            }
+
+            segment->word_count = word_count - segment->word_index;
+            segment->text = copy_text(
+                &pos, text + seg_text_index, seg_text_limit - seg_text_index);
+        }
+    }
+
+    assert((size_t)(pos - (char *)mem) <= size);
+
+    ret_val->segment_count = segment_count;
+    ret_val->segments = segments;
+    ret_val->word_count = word_count;
+    ret_val->words = word_count == 0 ? nullptr : words;
+    ret_val->token_count = token_count;
+    ret_val->tokens = tokens;
+    return ret_val;
+}
+
+MT_EXPORT_STT_API struct mt_stt_result * __stdcall mt_stt_transcribe_result(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int const * const opt_parts_audio_data_indices,
+    int const * const opt_parts_audio_data_limits,
+    int const opt_parts_length)
+{
+    if(model == nullptr || params == nullptr
+        || (opt_parts_audio_data_indices == nullptr)
+            != (opt_parts_audio_data_limits == nullptr)
+        || (opt_parts_audio_data_indices == nullptr)
+            != (opt_parts_length == 0))
+    {
+        return nullptr;
+    }
+
+    std::vector<struct mt_stt_part_result> results;
+
+    if(!mt_stt_transcribe_results(
+            model,
+            *params,
+            audio_data_arr,
+            audio_data_length,
+            opt_parts_audio_data_indices,
+            opt_parts_audio_data_limits,
+            opt_parts_length,
+            false,
+            true,
+            results))
+    {
+        return nullptr;
+    }
+    return create_result(
+        results,
+        audio_data_length,
+        opt_parts_audio_data_indices,
+        opt_parts_audio_data_limits);
+}
@@ -0,0 +1,403 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+#include "whisper.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+
+// Segments ending less than this before the end of the window may still
+// change with more audio data, so they are tentative:
+//
+static int const s_tentative_samples = 16000;
+
+// If the window gets longer than this, all segments but the last one are
+// committed (even the ones that would still be tentative), to limit the
+// amount of audio data to be encoded per step:
+//
+static int const s_max_window_samples = 16000 * 24;
+
+static int const s_samples_per_timestamp = 16000 / 100; // 10 ms per unit.
+
+/** A streaming session (see mt_stt_stream_create()).
+ */
+struct mt_stt_stream
+{
+    struct mt_stt_model * model;
+    struct whisper_state * state; // Exclusively used by this session.
+
+    struct mt_stt_params mt_params;
+    std::string language; // Copy, mt_params.language points to it.
+    std::string initial_prompt; // Copy, mt_params.initial_prompt points to it.
+    std::string language_cache_key; // Copy, see mt_params.
+    struct whisper_full_params params;
+    struct mt_stt_guard guard; // Of mt_params.opt_decoding_params.
+    std::vector<whisper_token> initial_prompt_tokens;
+
+    // Initial prompt tokens and the tokens of the text committed so far,
+    // given as prompt for each step:
+    //
+    std::vector<whisper_token> prompt_tokens;
+
+    std::vector<float> window; // Audio data that is not committed, yet.
+    int step_samples;
+    int new_samples; // Count of samples pushed since the last step.
+
+    std::string text; // All text committed since creation or finalization.
+    std::string tentative_text; // As given to the callback at the last step.
+
+    void (*on_text_func)(
+        char const * stable_text, char const * tentative_text, void * user_data);
+    void * user_data;
+};
+
+/** Add the text tokens of the given segment to the prompt tokens, keeping the
+ *  initial prompt and the most recent tokens that fit.
+ */
+static void add_prompt_tokens(
+    struct mt_stt_stream * const stream, int const segment)
+{
+    struct whisper_context * const ctx = stream->model->ctx;
+    whisper_token const tok_eot = whisper_token_eot(ctx);
+    int const n = whisper_full_n_tokens_from_state(stream->state, segment);
+    size_t const max_tokens = (size_t)(whisper_n_text_ctx(ctx) / 2);
+    size_t const n_initial = stream->initial_prompt_tokens.size();
+
+    for(int j = 0; j < n; ++j)
+    {
+        whisper_token const id = whisper_full_get_token_id_from_state(
+            stream->state, segment, j);
+
+        if(tok_eot <= id)
+        {
+            continue; // Skip this special token.
+        }
+        stream->prompt_tokens.push_back(id);
+    }
+
+    if(max_tokens < stream->prompt_tokens.size())
+    {
+        size_t const n_remove = stream->prompt_tokens.size() - max_tokens;
+
+        assert(n_initial <= max_tokens); // See mt_stt_init_full_params().
+
+        stream->prompt_tokens.erase(
+            stream->prompt_tokens.begin() + n_initial,
+            stream->prompt_tokens.begin() + n_initial + n_remove);
+    }
+}
+
+/** Transcribe the current window, commit the segments that are stable (or
+ *  all segments, if final is true), drop their audio data from the window and
+ *  call the text callback.
+ *
+ * - Returns false on error.
+ */
+static bool step(struct mt_stt_stream * const stream, bool const final)
+{
+    if(stream->window.empty())
+    {
+        return true;
+    }
+
+    struct whisper_context * const ctx = stream->model->ctx;
+    struct whisper_full_params params = stream->params;
+    struct mt_stt_request req;
+    struct mt_stt_part part;
+    struct mt_stt_part_result result;
+    int const window_len = (int)stream->window.size();
+
+    // Detect the language once, as soon as there is enough audio data:
+    //
+    if(stream->mt_params.detect_language_once
+        && mt_stt_is_auto_language(stream->params.language)
+        && (final
+            || std::min(
+                    stream->mt_params.detect_language_ms * 16,
+                    s_max_window_samples) <= window_len))
+    {
+        char const * language = nullptr;
+
+        if(!mt_stt_detect_language(
+                stream->model,
+                stream->state,
+                stream->mt_params,
+                params.n_threads,
+                stream->window.data(),
+                window_len,
+                nullptr,
+                nullptr,
+                0,
+                language))
+        {
+            return false;
+        }
+        if(language != nullptr)
+        {
+            stream->params.language = language; // For all following steps.
+            params.language = language;
+        }
+    }
+
+    mt_stt_init_request(&req, stream->mt_params, 1);
+    req.on_segment_func = nullptr; // (segments are not stable, yet)
+    req.guard = stream->guard; // (decoding parameters are not kept)
+    part.req = &req;
+    part.index = 0;
+    part.audio_data_index = 0;
+    part.audio_data_length = window_len;
+
+    // The context is given explicitly:
+    //
+    params.prompt_tokens = stream->prompt_tokens.empty()
+        ? nullptr : stream->prompt_tokens.data();
+    params.prompt_n_tokens = (int)stream->prompt_tokens.size();
+
+    stream->new_samples = 0;
+
+    if(!mt_stt_transcribe_part(
+            ctx,
+            stream->state,
+            params,
+            &part,
+            true,
+            true,
+            stream->window.data(),
+            window_len,
+            &result))
+    {
+        return false;
+    }
+
+    int const n = whisper_full_n_segments_from_state(stream->state);
+    int n_commit = 0;
+    int commit_samples = 0; // Count of samples of the window to drop.
+
+    if(final)
+    {
+        n_commit = n;
+        commit_samples = window_len;
+    }
+    else
+    {
+        bool const too_long = s_max_window_samples <= window_len;
+
+        for(int i = 0; i < n; ++i)
+        {
+            int const end = (int)whisper_full_get_segment_t1_from_state(
+                stream->state, i) * s_samples_per_timestamp;
+
+            if(i == n - 1 && !(too_long && n == 1))
+            {
+                break; // The last segment may still change.
+            }
+            if(!too_long && window_len - s_tentative_samples < end)
+            {
+                break; // Too close to the end of the window.
+            }
+            n_commit = i + 1;
+            commit_samples = end < window_len ? end : window_len;
+        }
+
+        if(n == 0 && too_long)
+        {
+            // No speech, drop audio data, but keep the most recent samples:
+            //
+            commit_samples = window_len - s_tentative_samples;
+        }
+    }
+
+    std::string stable_text;
+
+    for(int i = 0; i < n_commit; ++i)
+    {
+        stable_text += whisper_full_get_segment_text_from_state(
+            stream->state, i);
+        add_prompt_tokens(stream, i);
+    }
+
+    std::string tentative_text;
+
+    for(int i = n_commit; i < n; ++i)
+    {
+        tentative_text += whisper_full_get_segment_text_from_state(
+            stream->state, i);
+    }
+
+    // Already committed audio data will never be encoded, again:
+    //
+    stream->window.erase(
+        stream->window.begin(), stream->window.begin() + commit_samples);
+
+    stream->text += stable_text;
+
+    if(stream->on_text_func != nullptr
+        && (!stable_text.empty() || tentative_text != stream->tentative_text))
+    {
+        stream->on_text_func(
+            stable_text.c_str(), tentative_text.c_str(), stream->user_data);
+    }
+    stream->tentative_text.swap(tentative_text);
+    return true;
+}
+
+MT_EXPORT_STT_API struct mt_stt_stream * __stdcall mt_stt_stream_create(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    int const step_ms,
+    void (*on_text_func)(
+        char const * stable_text, char const * tentative_text, void * user_data),
+    void * const user_data)
+{
+    if(model == nullptr || params == nullptr)
+    {
+        return nullptr;
+    }
+
+    mt_stt_open_log();
+
+    struct mt_stt_stream * const stream = new mt_stt_stream;
+
+    stream->model = model;
+    stream->mt_params = *params;
+    if(params->language != nullptr)
+    {
+        stream->language = params->language;
+        stream->mt_params.language = stream->language.c_str();
+    }
+    if(params->initial_prompt != nullptr)
+    {
+        stream->initial_prompt = params->initial_prompt;
+        stream->mt_params.initial_prompt = stream->initial_prompt.c_str();
+    }
+    if(params->opt_language_cache_key != nullptr)
+    {
+        stream->language_cache_key = params->opt_language_cache_key;
+        stream->mt_params.opt_language_cache_key =
+            stream->language_cache_key.c_str();
+    }
+    stream->mt_params.on_progress_func = nullptr; // Not supported.
+    stream->mt_params.opt_out_metrics = nullptr; // Not supported.
+    stream->mt_params.opt_out_language = nullptr; // Not supported.
+    stream->mt_params.return_partial_on_abort = false; // Not supported.
+    stream->mt_params.opt_out_aborted = nullptr; // Not supported.
+
+    if(!mt_stt_init_full_params(
+            model,
+            stream->mt_params,
+            stream->params,
+            stream->initial_prompt_tokens))
+    {
+        delete stream;
+        mt_stt_close_log();
+        return nullptr;
+    }
+    mt_stt_get_guard(stream->mt_params.opt_decoding_params, stream->guard);
+    stream->mt_params.prompt_tokens = nullptr; // Copied, see above.
+    stream->mt_params.opt_decoding_params = nullptr; // Applied, see above.
+
+    // Necessary to commit segments:
+    //
+    stream->params.single_segment = false;
+    stream->params.no_timestamps = false;
+    stream->prompt_tokens = stream->initial_prompt_tokens;
+
+    if(stream->mt_params.detect_language_once
+        && mt_stt_is_auto_language(stream->params.language))
+    {
+        char const * language = nullptr;
+
+        if(mt_stt_get_cached_language(model, stream->mt_params, language))
+        {
+            stream->params.language = language; // Detected before.
+        }
+    }
+
+    stream->state = mt_stt_acquire_state(model);
+    if(stream->state == nullptr)
+    {
+        mt_stt_log_printf(
+            MT_STT_LOG_LEVEL_ERROR, "Error: Failed to create Whisper state!\n");
+        delete stream;
+        mt_stt_close_log();
+        return nullptr;
+    }
+
+    stream->step_samples = (0 < step_ms ? step_ms : 500) * 16;
+    stream->new_samples = 0;
+    stream->on_text_func = on_text_func;
+    stream->user_data = user_data;
+    return stream;
+}
+
+MT_EXPORT_STT_API bool __stdcall mt_stt_stream_push(
+    struct mt_stt_stream * const stream,
+    float const * const audio_data_arr,
+    int const audio_data_length)
+{
+    if(stream == nullptr || audio_data_arr == nullptr || audio_data_length < 0)
+    {
+        return false;
+    }
+
+    stream->window.insert(
+        stream->window.end(),
+        audio_data_arr,
+        audio_data_arr + audio_data_length);
+    stream->new_samples += audio_data_length;
+
+    if(stream->new_samples < stream->step_samples)
+    {
+        return true;
+    }
+    return step(stream, false);
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_stream_finalize(
+    struct mt_stt_stream * const stream)
+{
+    if(stream == nullptr)
+    {
+        return nullptr;
+    }
+
+    bool const ok = step(stream, true);
+    char* const ret_val = ok ? mt_stt_create_copy(stream->text) : nullptr;
+
+    // Ready for the next utterance:
+    //
+    stream->window.clear();
+    stream->new_samples = 0;
+    stream->text.clear();
+    stream->tentative_text.clear();
+    stream->mt_params.prompt_tokens = nullptr; // Copied, see above.
+    stream->prompt_tokens = stream->initial_prompt_tokens;
+
+    return ret_val;
+}
+
+MT_EXPORT_STT_API void __stdcall mt_stt_stream_free(
+    struct mt_stt_stream * const stream)
+{
+    if(stream == nullptr)
+    {
+        return;
+    }
+
+    mt_stt_release_state(stream->model, stream->state);
+    stream->state = nullptr;
+    delete stream;
+    mt_stt_close_log();
+}
@@ -0,0 +1,307 @@
+
+// RhinoDevel, Marcel Timm, 2026oct17
+
+// Energy-based voice activity detection, to transcribe the parts of the audio
+// data holding speech, only.
+
+// This is kind of a hack:
+//
+#ifndef MT_EXPORT_STT
+    #define MT_EXPORT_STT
+#endif //MT_EXPORT_STT
+
+#include "mt_stt.h"
+#include "mt_stt_internal.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// * Hard-coded for a sample rate of 16000 Hz!
+//
+static int const s_samples_per_ms = 16;
+static int const s_frame_ms = 20;
+static int const s_frame_samples = s_frame_ms * s_samples_per_ms;
+
+// The noise floor is at least this far below the peak energy (the 99th
+// percentile), because the 10th percentile is speech for audio data with
+// (almost) no silence:
+//
+static float const s_min_floor_below_peak_db = 30.0f;
+
+/** A span of speech in samples (limit is exclusive).
+ */
+struct span
+{
+    int index;
+    int limit;
+};
+
+/** Get the energy of the given samples in dBFS.
+ */
+static float get_energy_db(float const * const samples, int const count)
+{
+    float sum = 0.0f;
+
+    for(int i = 0; i < count; ++i)
+    {
+        sum += samples[i] * samples[i];
+    }
+    return 10.0f * log10f(sum / (float)count + 1e-10f);
+}
+
+/** Detect the spans of speech in the given audio data.
+ *
+ * - A frame is speech, if its energy is at least params.vad_threshold_db above
+ *   the estimated noise floor (the 10th percentile of all frames' energies,
+ *   but at least s_min_floor_below_peak_db below the peak energy) and at
+ *   least params.vad_min_energy_db.
+ * - Speech separated by less than params.vad_min_silence_ms of silence is
+ *   merged, speech shorter than params.vad_min_speech_ms is dropped and each
+ *   span gets params.vad_pad_ms of padding on both sides.
+ */
+static std::vector<struct span> detect(
+    struct mt_stt_params const & params_ref,
+    float const * const audio_data_arr,
+    int const audio_data_length)
+{
+    std::vector<struct span> ret_val;
+    int const frame_count = audio_data_length / s_frame_samples
+        + (audio_data_length % s_frame_samples == 0 ? 0 : 1);
+
+    if(frame_count == 0)
+    {
+        return ret_val;
+    }
+
+    std::vector<float> energies(frame_count);
+
+    for(int i = 0; i < frame_count; ++i)
+    {
+        int const index = i * s_frame_samples;
+        int const count = std::min(s_frame_samples, audio_data_length - index);
+
+        energies[i] = get_energy_db(audio_data_arr + index, count);
+    }
+
+    std::vector<float> sorted = energies;
+    size_t const floor_index = sorted.size() / 10;
+    size_t const peak_index = sorted.size() * 99 / 100;
+
+    std::nth_element(
+        sorted.begin(), sorted.begin() + peak_index, sorted.end());
+
+    float const peak = sorted[peak_index];
+
+    std::nth_element( // (all frames before the peak index are not louder)
+        sorted.begin(),
+        sorted.begin() + floor_index,
+        sorted.begin() + peak_index);
+
+    float const noise_floor =
+        std::min(sorted[floor_index], peak - s_min_floor_below_peak_db);
+    float const threshold = std::max(
+        noise_floor + params_ref.vad_threshold_db,
+        params_ref.vad_min_energy_db);
+    int const min_silence_frames = params_ref.vad_min_silence_ms / s_frame_ms;
+    int const min_speech_frames = params_ref.vad_min_speech_ms / s_frame_ms;
+    int const pad = params_ref.vad_pad_ms * s_samples_per_ms;
+
+    // Find runs of speech frames, merging runs with short silence between:
+
+    std::vector<struct span> runs; // In frames.
+
+    for(int i = 0; i < frame_count; ++i)
+    {
+        if(energies[i] < threshold)
+        {
+            continue;
+        }
+        if(!runs.empty() && i - runs.back().limit < min_silence_frames)
+        {
+            runs.back().limit = i + 1;
+            continue;
+        }
+        runs.push_back({ i, i + 1 });
+    }
+
+    // Drop short runs, convert to samples, add padding and merge overlaps:
+
+    for(struct span const & run : runs)
+    {
+        if(run.limit - run.index < min_speech_frames)
+        {
+            continue;
+        }
+
+        int const index = std::max(0, run.index * s_frame_samples - pad);
+        int const limit = std::min(
+            audio_data_length, run.limit * s_frame_samples + pad);
+
+        if(!ret_val.empty() && index <= ret_val.back().limit)
+        {
+            ret_val.back().limit = limit;
+            continue;
+        }
+        ret_val.push_back({ index, limit });
+    }
+    return ret_val;
+}
+
+/** Copy the spans to dynamically allocated arrays the caller takes ownership
+ *  of (freed via mt_stt_free()).
+ *
+ * - Returns false on error.
+ */
+static bool create_arrays(
+    std::vector<struct span> const & spans_ref,
+    int * * const out_indices,
+    int * * const out_limits)
+{
+    *out_indices = nullptr;
+    *out_limits = nullptr;
+    if(spans_ref.empty())
+    {
+        return true;
+    }
+
+    *out_indices = (int*)malloc(spans_ref.size() * sizeof **out_indices);
+    *out_limits = (int*)malloc(spans_ref.size() * sizeof **out_limits);
+    if(*out_indices == nullptr || *out_limits == nullptr)
+    {
+        free(*out_indices);
+        *out_indices = nullptr;
+        free(*out_limits);
+        *out_limits = nullptr;
+        return false; // Must not get here.
+    }
+
+    for(size_t i = 0; i < spans_ref.size(); ++i)
+    {
+        (*out_indices)[i] = spans_ref[i].index;
+        (*out_limits)[i] = spans_ref[i].limit;
+    }
+    return true;
+}
+
+MT_EXPORT_STT_API int __stdcall mt_stt_detect_speech(
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    int * * const out_parts_audio_data_indices,
+    int * * const out_parts_audio_data_limits)
+{
+    if(params == nullptr || audio_data_arr == nullptr || audio_data_length < 0
+        || out_parts_audio_data_indices == nullptr
+        || out_parts_audio_data_limits == nullptr)
+    {
+        return -1;
+    }
+
+    std::vector<struct span> const spans = detect(
+        *params, audio_data_arr, audio_data_length);
+
+    if(!create_arrays(
+            spans, out_parts_audio_data_indices, out_parts_audio_data_limits))
+    {
+        return -1;
+    }
+    return (int)spans.size();
+}
+
+MT_EXPORT_STT_API char* __stdcall mt_stt_transcribe_with_vad(
+    struct mt_stt_model * const model,
+    struct mt_stt_params const * const params,
+    float const * const audio_data_arr,
+    int const audio_data_length,
+    float * * const opt_out_word_probs,
+    int * opt_out_word_probs_count,
+    int * * const out_parts_audio_data_indices,
+    int * * const out_parts_audio_data_limits,
+    int * * const out_parts_ret_val_indices,
+    int * const out_parts_length)
+{
+    if(model == nullptr || params == nullptr
+        || ((opt_out_word_probs == nullptr)
+            != (opt_out_word_probs_count == nullptr))
+        || out_parts_audio_data_indices == nullptr
+        || out_parts_audio_data_limits == nullptr
+        || out_parts_ret_val_indices == nullptr || out_parts_length == nullptr)
+    {
+        return nullptr;
+    }
+    *out_parts_ret_val_indices = nullptr;
+    *out_parts_length = 0;
+
+    int const count = mt_stt_detect_speech(
+        params,
+        audio_data_arr,
+        audio_data_length,
+        out_parts_audio_data_indices,
+        out_parts_audio_data_limits);
+
+    if(count < 0)
+    {
+        return nullptr;
+    }
+
+    if(count == 0) // => Nothing to transcribe (the encoder is not run at all).
+    {
+        if(opt_out_word_probs != nullptr)
+        {
+            *opt_out_word_probs = nullptr;
+            *opt_out_word_probs_count = 0;
+        }
+        if(params->opt_out_metrics != nullptr)
+        {
+            memset(params->opt_out_metrics, 0, sizeof *params->opt_out_metrics);
+            params->opt_out_metrics->cpu_variant = model->cpu_variant;
+        }
+        if(params->opt_out_language != nullptr)
+        {
+            params->opt_out_language->code = nullptr;
+            params->opt_out_language->p = 0.0f;
+        }
+        if(params->opt_out_aborted != nullptr)
+        {
+            *params->opt_out_aborted = false;
+        }
+        return (char*)calloc(1, sizeof(char));
+    }
+
+    *out_parts_ret_val_indices =
+        (int*)malloc(count * sizeof **out_parts_ret_val_indices);
+    if(*out_parts_ret_val_indices == nullptr)
+    {
+        return nullptr; // Must not get here.
+    }
+
+    char* const ret_val = mt_stt_transcribe_with_params(
+        model,
+        params,
+        audio_data_arr,
+        audio_data_length,
+        opt_out_word_probs,
+        opt_out_word_probs_count,
+        *out_parts_ret_val_indices,
+        *out_parts_audio_data_indices,
+        *out_parts_audio_data_limits,
+        count);
+
+    if(ret_val == nullptr)
+    {
+        free(*out_parts_audio_data_indices);
+        *out_parts_audio_data_indices = nullptr;
+        free(*out_parts_audio_data_limits);
+        *out_parts_audio_data_limits = nullptr;
+        free(*out_parts_ret_val_indices);
+        *out_parts_ret_val_indices = nullptr;
+        return nullptr;
+    }
+
+    *out_parts_length = count;
+    return ret_val;
+}